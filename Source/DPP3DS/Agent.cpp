@@ -34,6 +34,14 @@ void AAgent::BeginPlay()
 }
 
 bool AAgent::preparePathPlanning(int32 start, int32 goal)
+{
+	if (!canClimb) { return preparePathPlanning(start, goal, FWalkerCostPolicy()); }
+	if (useCustomPenalties) { return preparePathPlanning(start, goal, FCustomCostPolicy(customPenalties)); }
+	return preparePathPlanning(start, goal, FClimberCostPolicy());
+}
+
+template<typename TPolicy>
+bool AAgent::preparePathPlanning(int32 start, int32 goal, const TPolicy& policy)
 {
 	//Reset the path, map, open vertex set and closed vertex set
 	path.Empty();
@@ -42,7 +50,7 @@ bool AAgent::preparePathPlanning(int32 start, int32 goal)
 	closedVertexSet.Empty();
 
 	//Reset the G value for every vertex
-	for (AVertex* vertex : prmCollector->vertices) { if (canClimb) { vertex->gC = 999999; } else { vertex->g = 999999; } }
+	for (AVertex* vertex : prmCollector->vertices) { policy.getG(vertex) = 999999; }
 
 	//Stop preparations if the start of goal id's are not valid for the vertex array
 	if (start < 0 || start > prmCollector->vertices.Num() || goal < 0 || goal > prmCollector->vertices.Num()) {
@@ -61,20 +69,15 @@ bool AAgent::preparePathPlanning(int32 start, int32 goal)
 	}
 
 	//Prepare the start location
-	if (canClimb) {
-		startVertex->gC = 0;
-		startVertex->fC = (goalVertex->GetActorLocation() - startVertex->GetActorLocation()).Size();
-	}
-	else {
-		startVertex->g = 0;
-		startVertex->f = (goalVertex->GetActorLocation() - startVertex->GetActorLocation()).Size();
-	}
+	policy.getG(startVertex) = 0;
+	policy.getF(startVertex) = (goalVertex->GetActorLocation() - startVertex->GetActorLocation()).Size();
 	openVertexSet.Add(startVertex->id);
 
 	return true;
 }
 
-int32 AAgent::findNextVertexInOpenSet()
+template<typename TPolicy>
+int32 AAgent::findNextVertexInOpenSet(const TPolicy& policy)
 {
 	int32 returnValue = -1;
 	float lowestCost = 999999;
@@ -83,21 +86,11 @@ int32 AAgent::findNextVertexInOpenSet()
 	for (int32 vertexID : openVertexSet) {
 		AVertex* vertex = prmCollector->getVertex(vertexID);
 		if (vertex) {
-			if (canClimb) {
-				float cost = vertex->fC;
+			float cost = policy.getF(vertex);
 
-				if (cost < lowestCost) {
-					lowestCost = cost;
-					returnValue = vertexID;
-				}
-			}
-			else {
-				float cost = vertex->f;
-
-				if (cost < lowestCost) {
-					lowestCost = cost;
-					returnValue = vertexID;
-				}
+			if (cost < lowestCost) {
+				lowestCost = cost;
+				returnValue = vertexID;
 			}
 		}
 		else {
@@ -108,67 +101,102 @@ int32 AAgent::findNextVertexInOpenSet()
 	return returnValue;
 }
 
-void AAgent::findNeighbours(AVertex* vertex, AVertex* goal)
+template<typename TPolicy>
+void AAgent::findNeighbours(AVertex* vertex, AVertex* goal, const TPolicy& policy)
 {
 	int32 vertexID = vertex->id;
 
-	//Check all neighbours that are not in the closed vertex set
+	//Reset the neighbour row
+	rowVertices.Reset();
+	rowX.Reset();
+	rowY.Reset();
+	rowZ.Reset();
+	rowPenalty.Reset();
+
+	//Gather all neighbours that are not in the closed vertex set and that the agent can move onto
 	for (int32 neighbourID : vertex->neighbours) {
 		if (!closedVertexSet.Contains(neighbourID)) {
 			AVertex* neighbour = prmCollector->getVertex(neighbourID);
-
-			//If the agent cannot climb, don't consider non-floors and non-stair floors as candidates
-			if (canClimb || neighbour->surface == ESurfaceType::Floor || neighbour->surface == ESurfaceType::Stairs || neighbour->surface == ESurfaceType::TransitionStairs) {
-				//The new g value is the one for the predecessor + the distance between predecessor and neighbour
-				if (canClimb) {
-					float newG = vertex->gC + (neighbour->GetActorLocation() - vertex->GetActorLocation()).Size();
-					//Update the values if the new g value is lower
-					if (newG < neighbour->gC) {
-						predecessorMap.Add(neighbourID, vertexID);
-						neighbour->gC = newG;
-
-						//Add a penalty for moving to another surface
-						float surfacePenalty = 0;
-						if (canClimb && neighbour->surface != vertex->surface) { surfacePenalty = 400; }
-
-						//Add a penalty for using stairs as a climber
-						float stairsPenalty = 0;
-						if (canClimb && (neighbour->surface == ESurfaceType::Stairs || neighbour->surface == ESurfaceType::StairsCeiling || neighbour->surface == ESurfaceType::TransitionStairs)) {
-							stairsPenalty = 400;
-						}
-
-						//f = g + h + surfacePenalty + stairsPenalty. h = Euclidean Distance to the goal
-						neighbour->fC = newG + (goal->GetActorLocation() - neighbour->GetActorLocation()).Size() + surfacePenalty + stairsPenalty;
-
-						if (!openVertexSet.Contains(neighbour->id)) { openVertexSet.Add(neighbour->id); }
-					}
-				}
-				else {
-					float newG = vertex->g + (neighbour->GetActorLocation() - vertex->GetActorLocation()).Size();
-					//Update the values if the new g value is lower
-					if (newG < neighbour->g) {
-						predecessorMap.Add(neighbourID, vertexID);
-						neighbour->g = newG;
-
-						//Add a penalty for moving to another surface
-						float surfacePenalty = 0;
-						if (canClimb && neighbour->surface != vertex->surface) { surfacePenalty = 400; }
-
-						//Add a penalty for using stairs as a climber
-						float stairsPenalty = 0;
-						if (canClimb && (neighbour->surface == ESurfaceType::Stairs || neighbour->surface == ESurfaceType::StairsCeiling || neighbour->surface == ESurfaceType::TransitionStairs)) {
-							stairsPenalty = 400;
-						}
-
-						//f = g + h + surfacePenalty + stairsPenalty. h = Euclidean Distance to the goal
-						neighbour->f = newG + (goal->GetActorLocation() - neighbour->GetActorLocation()).Size() + surfacePenalty + stairsPenalty;
-
-						if (!openVertexSet.Contains(neighbour->id)) { openVertexSet.Add(neighbour->id); }
-					}
-				}
+			if (neighbour == nullptr) { continue; }
+
+			if (policy.canTraverse(neighbour->surface)) {
+				FVector location = neighbour->GetActorLocation();
+				rowVertices.Add(neighbour);
+				rowX.Add(location.X);
+				rowY.Add(location.Y);
+				rowZ.Add(location.Z);
+				rowPenalty.Add(policy.getPenalty(vertex->surface, neighbour->surface));
 			}
 		}
 	}
+
+	//Compute the new g and f values of the whole row at once
+	relaxNeighbourRow(vertex->GetActorLocation(), goal->GetActorLocation(), policy.getG(vertex), rowVertices.Num());
+
+	//Only update the neighbours for which the new g value is lower
+	for (int32 i = 0; i < rowVertices.Num(); i++) {
+		AVertex* neighbour = rowVertices[i];
+		float& neighbourG = policy.getG(neighbour);
+
+		if (rowG[i] < neighbourG) {
+			predecessorMap.Add(neighbour->id, vertexID);
+			neighbourG = rowG[i];
+			policy.getF(neighbour) = rowF[i];
+
+			if (!openVertexSet.Contains(neighbour->id)) { openVertexSet.Add(neighbour->id); }
+		}
+	}
+}
+
+void AAgent::relaxNeighbourRow(FVector from, FVector goal, float baseG, int32 count)
+{
+	rowG.SetNumUninitialized(count);
+	rowF.SetNumUninitialized(count);
+	int32 i = 0;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+	//Handle four neighbours at a time. g = baseG + |neighbour - from|; f = g + |goal - neighbour| + penalty
+	const VectorRegister fromX = VectorSetFloat1(from.X);
+	const VectorRegister fromY = VectorSetFloat1(from.Y);
+	const VectorRegister fromZ = VectorSetFloat1(from.Z);
+	const VectorRegister goalX = VectorSetFloat1(goal.X);
+	const VectorRegister goalY = VectorSetFloat1(goal.Y);
+	const VectorRegister goalZ = VectorSetFloat1(goal.Z);
+	const VectorRegister base = VectorSetFloat1(baseG);
+	const VectorRegister minimum = VectorSetFloat1(SMALL_NUMBER);
+
+	for (; i + 4 <= count; i += 4) {
+		const VectorRegister x = VectorLoad(&rowX[i]);
+		const VectorRegister y = VectorLoad(&rowY[i]);
+		const VectorRegister z = VectorLoad(&rowZ[i]);
+
+		//Squared lengths of the edges and of the remaining distances to the goal
+		VectorRegister dx = VectorSubtract(x, fromX);
+		VectorRegister dy = VectorSubtract(y, fromY);
+		VectorRegister dz = VectorSubtract(z, fromZ);
+		const VectorRegister edgeSquared = VectorMultiplyAdd(dx, dx, VectorMultiplyAdd(dy, dy, VectorMultiply(dz, dz)));
+		dx = VectorSubtract(goalX, x);
+		dy = VectorSubtract(goalY, y);
+		dz = VectorSubtract(goalZ, z);
+		const VectorRegister goalSquared = VectorMultiplyAdd(dx, dx, VectorMultiplyAdd(dy, dy, VectorMultiply(dz, dz)));
+
+		//Length = squared length * 1 / sqrt(squared length). The minimum keeps zero lengths at zero
+		const VectorRegister edgeLength = VectorMultiply(edgeSquared, VectorReciprocalSqrtAccurate(VectorMax(edgeSquared, minimum)));
+		const VectorRegister goalLength = VectorMultiply(goalSquared, VectorReciprocalSqrtAccurate(VectorMax(goalSquared, minimum)));
+
+		const VectorRegister g = VectorAdd(base, edgeLength);
+		const VectorRegister f = VectorAdd(VectorAdd(g, goalLength), VectorLoad(&rowPenalty[i]));
+		VectorStore(g, &rowG[i]);
+		VectorStore(f, &rowF[i]);
+	}
+#endif
+
+	//Scalar version for the remaining neighbours, or all of them if there are no vector intrinsics
+	for (; i < count; i++) {
+		FVector location = FVector(rowX[i], rowY[i], rowZ[i]);
+		rowG[i] = baseG + (location - from).Size();
+		rowF[i] = rowG[i] + (goal - location).Size() + rowPenalty[i];
+	}
 }
 
 void AAgent::createPath(int32 goal)
@@ -193,6 +221,14 @@ void AAgent::resetGoal(AVertex* goal, int32 round) {
 }
 
 void AAgent::handleDynamicVertex(AVertex * vertex)
+{
+	//The dynamic wave always moves over every surface, so only the penalties differ
+	if (useCustomPenalties) { handleDynamicVertex(vertex, FCustomCostPolicy(customPenalties)); }
+	else { handleDynamicVertex(vertex, FClimberCostPolicy()); }
+}
+
+template<typename TPolicy>
+void AAgent::handleDynamicVertex(AVertex * vertex, const TPolicy& policy)
 {
 	//Go over all neighbours of the vertex
 	for (int32 neighbourID : vertex->neighbours) {
@@ -200,15 +236,9 @@ void AAgent::handleDynamicVertex(AVertex * vertex)
 		//Only update this vertex if it has not been handled in the latest round
 		if (neighbour->dpRound < vertex->dpRound) {
 			neighbour->dpRound = vertex->dpRound;
-			neighbour->dpDistance = (neighbour->GetActorLocation() - vertex->GetActorLocation()).Size();
 
-			//Add a penalty for moving to another surface
-			if (neighbour->surface != vertex->surface) { neighbour->dpDistance += 400; }
-
-			//Add a penalty for using the stairs
-			if (neighbour->surface == ESurfaceType::Stairs || neighbour->surface == ESurfaceType::StairsCeiling || neighbour->surface == ESurfaceType::TransitionStairs) {
-				neighbour->dpDistance += 400;
-			}
+			//Distance plus the penalties for moving to another surface and using the stairs
+			neighbour->dpDistance = (neighbour->GetActorLocation() - vertex->GetActorLocation()).Size() + policy.getPenalty(vertex->surface, neighbour->surface);
 
 			neighbour->dpDirection = vertex->id;
 			openVertexSet.Add(neighbourID);
@@ -264,10 +294,17 @@ bool AAgent::navigate(AVertex * start, AVertex * goal)
 
 bool AAgent::aStar(int32 start, int32 goal)
 {
+	if (!canClimb) { return aStar(start, goal, FWalkerCostPolicy()); }
+	if (useCustomPenalties) { return aStar(start, goal, FCustomCostPolicy(customPenalties)); }
+	return aStar(start, goal, FClimberCostPolicy());
+}
 
+template<typename TPolicy>
+bool AAgent::aStar(int32 start, int32 goal, const TPolicy& policy)
+{
 	//While there are still vertices to check, do so
 	while (openVertexSet.Num() > 0) {
-		int32 nextID = findNextVertexInOpenSet();
+		int32 nextID = findNextVertexInOpenSet(policy);
 		AVertex* successorVertex = prmCollector->getVertex(nextID);
 			
 		//Stop pathfinding if some vertexID does not exist. This should never be reached.
@@ -279,13 +316,19 @@ bool AAgent::aStar(int32 start, int32 goal)
 			//If the goal has been reached, reconstruct the path towards the goal. Path planning has been a success.
 			if (nextID == goal) {
 				createPath(goal);
+
+				//Edges of a lazy PRM are only checked once they are on a path. If one is blocked it is removed, so search again
+				if (prmCollector->lazyEdges && !prmCollector->validatePath(path)) {
+					if (!preparePathPlanning(start, goal, policy)) { return false; }
+					continue;
+				}
 				return true;
 			}
 
 			//This is not the goal, so finish off this vertex.
 			openVertexSet.Remove(nextID);
 			closedVertexSet.Add(nextID);
-			findNeighbours(successorVertex, prmCollector->getVertex(goal));
+			findNeighbours(successorVertex, prmCollector->getVertex(goal), policy);
 		}
 	}
 
@@ -294,6 +337,12 @@ bool AAgent::aStar(int32 start, int32 goal)
 	return false;
 }
 
+bool AAgent::planPath(int32 start, int32 goal)
+{
+	if (!preparePathPlanning(start, goal)) { return false; }
+	return aStar(start, goal);
+}
+
 bool AAgent::aStarStepwise(int32 start, int32 goal)
 {
 	bool returnValue = aStar(start, goal);
@@ -310,7 +359,7 @@ bool AAgent::aStarStepwise(int32 start, int32 goal)
 		}
 
 		//Change the goal vertex to this closer one in order to keep the tick function working as intended
-		goalVertex = prmCollector->findVertex(path[0]);
+		goalVertex = prmCollector->getVertex(path[0]);
 	}
 
 	return returnValue;
@@ -7,6 +7,7 @@
 #include "Utils.h"
 #include "Vertex.h"
 #include "PRMCollector.h"
+#include "CostPolicy.h"
 #include "Agent.generated.h"
 
 UCLASS()
@@ -26,6 +27,14 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Movement")
 		bool canClimb;
 
+	//Whether this agent uses the custom penalties below instead of the default climbing penalties. Only used if the agent can climb
+	UPROPERTY(EditAnywhere, Category = "Movement")
+		bool useCustomPenalties;
+
+	//Custom penalties for moving to other surfaces, using the stairs and moving onto specific surface types
+	UPROPERTY(EditAnywhere, Category = "Movement")
+		FCostPenalties customPenalties;
+
 	//Whether to show the path that the agent will take
 	UPROPERTY(EditAnywhere, Category = "Navigation")
 		bool showPath;
@@ -97,6 +106,15 @@ public:
 	//Indicates that this agent can move; used in the Dynamic Programming Approach
 	bool canMove;
 
+	//Neighbour row used when relaxing the neighbours of a vertex, stored as separate arrays per coordinate so that they can be handled four at a time
+	TArray<AVertex*> rowVertices;
+	TArray<float> rowX;
+	TArray<float> rowY;
+	TArray<float> rowZ;
+	TArray<float> rowPenalty;
+	TArray<float> rowG;
+	TArray<float> rowF;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -115,12 +133,16 @@ protected:
 
 	//Prepares the path planning algorithm
 	bool preparePathPlanning(int32 start, int32 goal);
+	template<typename TPolicy> bool preparePathPlanning(int32 start, int32 goal, const TPolicy& policy);
 
 	//Finds the next point to use in the open vertex set
-	int32 findNextVertexInOpenSet();
+	template<typename TPolicy> int32 findNextVertexInOpenSet(const TPolicy& policy);
 
 	//FInd the neighbouring points of a vertex with a certain id
-	void findNeighbours(AVertex* vertex, AVertex* goal);
+	template<typename TPolicy> void findNeighbours(AVertex* vertex, AVertex* goal, const TPolicy& policy);
+
+	//Computes the new g and f values of the gathered neighbour row. Uses vector intrinsics if available, otherwise the scalar loop
+	void relaxNeighbourRow(FVector from, FVector goal, float baseG, int32 count);
 
 	//Construct a path based on the pathmap. Note that the path is given in reverse
 	void createPath(int32 goal);
@@ -130,16 +152,24 @@ protected:
 
 	//Handles a vertex in the Dynamic Programming Method
 	void handleDynamicVertex(AVertex* vertex);
+	template<typename TPolicy> void handleDynamicVertex(AVertex* vertex, const TPolicy& policy);
 
 	// Main path planning algorithm, which uses a subroutine based on the path planning method
 	bool navigate(AVertex* start, AVertex* goal);
 
-	// A* algorithm
+	// A* algorithm. The version without a policy picks the cost policy of this agent
 	bool aStar(int32 start, int32 goal);
+	template<typename TPolicy> bool aStar(int32 start, int32 goal, const TPolicy& policy);
 
 	// Stepwise A* algorithm
 	bool aStarStepwise(int32 start, int32 goal);
 
+public:
+	//Plans a path from start to goal with A* and the cost policy of this agent without moving. Used to benchmark the roadmap
+	bool planPath(int32 start, int32 goal);
+
+protected:
+
 	//Basic movement function
 	void moveToVertex(int32 destination);
 
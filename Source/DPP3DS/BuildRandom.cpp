@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BuildRandom.h"
+
+FBuildRandom::FBuildRandom() { seed(0, EBuildStream::PRM, 0); }
+
+void FBuildRandom::seed(int32 buildSeed, EBuildStream type, int32 index)
+{
+	//The stream is chosen by the object, the starting point by the build seed
+	uint64 stream = ((uint64)type << 32) | (uint32)index;
+	state = 0;
+	increment = (stream << 1) | 1;
+	next();
+	state += (uint64)(uint32)buildSeed;
+	next();
+}
+
+uint32 FBuildRandom::next()
+{
+	uint64 old = state;
+	state = old * 6364136223846793005ULL + increment;
+
+	//Permute the old state so the low bits are as random as the high bits
+	uint32 shifted = (uint32)(((old >> 18) ^ old) >> 27);
+	uint32 rotation = (uint32)(old >> 59);
+	return (shifted >> rotation) | (shifted << ((0u - rotation) & 31));
+}
+
+float FBuildRandom::frand()
+{
+	//Use the top 24 bits, which is exactly the precision of a float
+	return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+float FBuildRandom::frandRange(float min, float max) { return min + (max - min) * frand(); }
+
+FHaltonSequence::FHaltonSequence()
+{
+	index = 0;
+	offset = FVector2D(0, 0);
+}
+
+void FHaltonSequence::reset(FBuildRandom& random)
+{
+	index = 0;
+	offset = FVector2D(random.frand(), random.frand());
+}
+
+FVector2D FHaltonSequence::next()
+{
+	//Index 0 is the origin in every base, so start at 1
+	index++;
+
+	//Shift the point by the offset and wrap it back into the unit square
+	double x = radicalInverse(index, 2) + offset.X;
+	double y = radicalInverse(index, 3) + offset.Y;
+	return FVector2D((float)(x - FMath::FloorToDouble(x)), (float)(y - FMath::FloorToDouble(y)));
+}
+
+double FHaltonSequence::radicalInverse(uint32 index, uint32 base)
+{
+	double inverseBase = 1.0 / base;
+	double factor = inverseBase;
+	double returnValue = 0;
+
+	while (index > 0) {
+		returnValue += (index % base) * factor;
+		index /= base;
+		factor *= inverseBase;
+	}
+
+	return returnValue;
+}
+
+FAliasTable::FAliasTable() {}
+
+void FAliasTable::reset()
+{
+	probabilities.Empty();
+	aliases.Empty();
+}
+
+void FAliasTable::build(const TArray<float>& weights)
+{
+	reset();
+
+	float total = 0;
+	for (float weight : weights) { total += FMath::Max(weight, 0.f); }
+	if (weights.Num() == 0 || total <= 0) { return; }
+
+	//Scale the weights so that their average is 1, then split them in columns that are under and over full
+	int32 count = weights.Num();
+	TArray<float> scaled;
+	TArray<int32> small;
+	TArray<int32> large;
+	scaled.SetNumUninitialized(count);
+	probabilities.SetNumUninitialized(count);
+	aliases.SetNumUninitialized(count);
+	for (int32 i = 0; i < count; i++) {
+		scaled[i] = FMath::Max(weights[i], 0.f) * count / total;
+		if (scaled[i] < 1) { small.Add(i); }
+		else { large.Add(i); }
+	}
+
+	//Fill every column that is under full with a part of a column that is over full
+	while (small.Num() > 0 && large.Num() > 0) {
+		int32 less = small.Pop(false);
+		int32 more = large.Pop(false);
+		probabilities[less] = scaled[less];
+		aliases[less] = more;
+
+		scaled[more] = (scaled[more] + scaled[less]) - 1;
+		if (scaled[more] < 1) { small.Add(more); }
+		else { large.Add(more); }
+	}
+
+	//What is left is full, apart from rounding errors
+	for (int32 i : large) { probabilities[i] = 1; aliases[i] = i; }
+	for (int32 i : small) { probabilities[i] = 1; aliases[i] = i; }
+}
+
+int32 FAliasTable::sample(FBuildRandom& random) const
+{
+	if (probabilities.Num() == 0) { return INDEX_NONE; }
+
+	int32 column = FMath::Min((int32)(random.frand() * probabilities.Num()), probabilities.Num() - 1);
+	return random.frand() < probabilities[column] ? column : aliases[column];
+}
+
+int32 FAliasTable::sample(float value, float& outRemainder) const
+{
+	outRemainder = 0;
+	if (probabilities.Num() == 0) { return INDEX_NONE; }
+
+	//The whole part of the scaled value picks the column, the fraction picks between the column and its alias
+	float scaled = FMath::Clamp(value, 0.f, 1.f) * probabilities.Num();
+	int32 column = FMath::Min((int32)scaled, probabilities.Num() - 1);
+	float fraction = FMath::Clamp(scaled - column, 0.f, 1.f);
+	float probability = probabilities[column];
+
+	if (fraction < probability || probability >= 1) {
+		outRemainder = probability > 0 ? FMath::Min(fraction / probability, 1.f) : 0;
+		return column;
+	}
+
+	outRemainder = (fraction - probability) / (1 - probability);
+	return aliases[column];
+}
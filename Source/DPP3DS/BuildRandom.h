@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Seeded random number streams and sequences used while building the PRMS. Every PRM, surface and cuboid owns its own stream, so a build can be repeated with the same seed
+ */
+
+//Kind of object a stream belongs to. Keeps the streams of objects with the same ID apart
+enum class EBuildStream : uint8 {
+	PRM,
+	Surface,
+	Cuboid
+};
+
+//PCG32 generator. The stream is selected through the increment, so streams with the same seed do not overlap
+class FBuildRandom
+{
+public:
+	FBuildRandom();
+
+	//Restarts the stream of the given object for the given build seed
+	void seed(int32 buildSeed, EBuildStream type, int32 index);
+
+	//Next raw 32 bit value of the stream
+	uint32 next();
+
+	//Random number in [0, 1)
+	float frand();
+
+	//Random number in [min, max)
+	float frandRange(float min, float max);
+
+private:
+	uint64 state;
+	uint64 increment;
+};
+
+//Two dimensional Halton sequence (bases 2 and 3), shifted by a random offset so each surface has its own sequence
+class FHaltonSequence
+{
+public:
+	FHaltonSequence();
+
+	//Restarts the sequence and draws a new offset from the given stream
+	void reset(FBuildRandom& random);
+
+	//Next point of the sequence, both coordinates in [0, 1)
+	FVector2D next();
+
+	//Mirrors the digits of the index in the given base around the decimal point
+	static double radicalInverse(uint32 index, uint32 base);
+
+private:
+	uint32 index;
+	FVector2D offset;
+};
+
+//Alias table (Vose) to draw an index with a probability proportional to its weight in constant time
+class FAliasTable
+{
+public:
+	FAliasTable();
+
+	//Removes all weights
+	void reset();
+
+	//Builds the table for the given weights, replacing the current contents. Negative weights count as 0
+	void build(const TArray<float>& weights);
+
+	//Draws an index from the given stream. Returns INDEX_NONE if the table is empty
+	int32 sample(FBuildRandom& random) const;
+
+	//Draws an index from a single value in [0, 1). The part of the value left over within the index is spread back over [0, 1) as outRemainder
+	int32 sample(float value, float& outRemainder) const;
+
+	//Amount of indices in the table
+	int32 num() const { return probabilities.Num(); }
+
+private:
+	//Chance to keep the drawn column instead of taking its alias
+	TArray<float> probabilities;
+
+	//Index that fills up the rest of each column
+	TArray<int32> aliases;
+};
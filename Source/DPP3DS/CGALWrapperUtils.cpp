@@ -73,7 +73,7 @@ FSurfPolygon::FSurfPolygon()
 
 FSurfPolygon::FSurfPolygon(TArray<FVector2D> inVertices, TArray<FVector> inVertices3D)
 {
-	vertices = inVertices;
+	vertices = MoveTemp(inVertices);
 	if (vertices.Num() > 0) { minVertex = vertices[0]; }
 
 	for (FVector2D vertex : vertices) {
@@ -83,7 +83,7 @@ FSurfPolygon::FSurfPolygon(TArray<FVector2D> inVertices, TArray<FVector> inVerti
 
 	minVertex = minVertex - FVector2D(5);
 	
-	vertices3D = inVertices3D;
+	vertices3D = MoveTemp(inVertices3D);
 	if (vertices3D.Num() > 0) { minVertex3D = vertices3D[0]; }
 
 	for (FVector vertex3D : vertices3D) {
@@ -227,7 +227,7 @@ FDTriangle::FDTriangle()
 
 FDTriangle::FDTriangle(TArray<FVector2D> inVertices)
 {
-	vertices = inVertices;
+	vertices = MoveTemp(inVertices);
 
 	//Only proceed if three vertices are given.
 	if (vertices.Num() == 3) {
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CollisionBVH.h"
+
+//Maximum amount of boxes in a leaf
+static const int32 BVH_LEAF_SIZE = 4;
+
+FCollisionBox::FCollisionBox(FBox inBox, bool inObstacle)
+{
+	box = inBox;
+	obstacle = inObstacle;
+}
+
+FCollisionBVHNode::FCollisionBVHNode()
+{
+	bounds = FBox(ForceInit);
+	left = INDEX_NONE;
+	right = INDEX_NONE;
+	first = 0;
+	count = 0;
+}
+
+FCollisionBVH::FCollisionBVH() {}
+
+void FCollisionBVH::reset()
+{
+	boxes.Empty();
+	nodes.Empty();
+}
+
+void FCollisionBVH::build(const TArray<FCollisionBox>& inBoxes)
+{
+	boxes = inBoxes;
+	nodes.Empty(FMath::Max(2 * boxes.Num() / BVH_LEAF_SIZE, 1));
+	buildRange(0, boxes.Num());
+}
+
+int32 FCollisionBVH::buildRange(int32 begin, int32 end)
+{
+	if (begin >= end) { return INDEX_NONE; }
+
+	//Find the bounds of the boxes and of their centers
+	int32 nodeIndex = nodes.Add(FCollisionBVHNode());
+	FBox bounds(ForceInit);
+	FBox centers(ForceInit);
+	for (int32 i = begin; i < end; i++) {
+		bounds += boxes[i].box;
+		centers += boxes[i].box.GetCenter();
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	//Few enough boxes left, so make a leaf
+	if (end - begin <= BVH_LEAF_SIZE) {
+		nodes[nodeIndex].first = begin;
+		nodes[nodeIndex].count = end - begin;
+		return nodeIndex;
+	}
+
+	//Split at the median along the longest axis of the centers
+	FVector centerSize = centers.GetSize();
+	int32 axis = centerSize.X >= centerSize.Y && centerSize.X >= centerSize.Z ? 0 : (centerSize.Y >= centerSize.Z ? 1 : 2);
+	Sort(boxes.GetData() + begin, end - begin, [axis](const FCollisionBox& a, const FCollisionBox& b) { return a.box.GetCenter()[axis] < b.box.GetCenter()[axis]; });
+	int32 median = (begin + end) / 2;
+
+	int32 left = buildRange(begin, median);
+	int32 right = buildRange(median, end);
+	nodes[nodeIndex].left = left;
+	nodes[nodeIndex].right = right;
+
+	return nodeIndex;
+}
+
+bool FCollisionBVH::sweepBox(FVector start, FVector end, FVector extent, bool includeObstacles) const
+{
+	if (nodes.Num() < 1) { return false; }
+
+	//A moving box hits a box if its center moves through that box grown by the extent of the moving box
+	float time;
+	TArray<int32, TInlineAllocator<64>> stack;
+	stack.Add(0);
+	while (stack.Num() > 0) {
+		const FCollisionBVHNode& node = nodes[stack.Pop(false)];
+		if (!intersectSegment(start, end, node.bounds.ExpandBy(extent), time)) { continue; }
+
+		//Check the boxes of a leaf, or continue with the children of an inner node
+		if (node.left == INDEX_NONE && node.right == INDEX_NONE) {
+			for (int32 i = node.first; i < node.first + node.count; i++) {
+				if (boxes[i].obstacle && !includeObstacles) { continue; }
+				if (intersectSegment(start, end, boxes[i].box.ExpandBy(extent), time)) { return true; }
+			}
+		}
+		else {
+			if (node.left != INDEX_NONE) { stack.Add(node.left); }
+			if (node.right != INDEX_NONE) { stack.Add(node.right); }
+		}
+	}
+
+	return false;
+}
+
+bool FCollisionBVH::intersectSegment(FVector start, FVector end, const FBox& box, float& time)
+{
+	//Slab test: clip the segment against the three pairs of planes of the box
+	FVector direction = end - start;
+	float tMin = 0;
+	float tMax = 1;
+
+	for (int32 axis = 0; axis < 3; axis++) {
+		if (FMath::Abs(direction[axis]) < KINDA_SMALL_NUMBER) {
+			//The segment is parallel to the slab, so it has to start inside it
+			if (start[axis] < box.Min[axis] || start[axis] > box.Max[axis]) { return false; }
+		}
+		else {
+			float inverse = 1.0f / direction[axis];
+			float t1 = (box.Min[axis] - start[axis]) * inverse;
+			float t2 = (box.Max[axis] - start[axis]) * inverse;
+			if (t1 > t2) { Swap(t1, t2); }
+			tMin = FMath::Max(tMin, t1);
+			tMax = FMath::Min(tMax, t2);
+			if (tMin > tMax) { return false; }
+		}
+	}
+
+	time = tMin;
+	return true;
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bounding volume hierarchy over the axis aligned boxes of the room walls and obstacles. Used to check if an edge is blocked without the physics scene
+ */
+
+//Box that can block an edge
+struct FCollisionBox
+{
+	FCollisionBox(FBox inBox, bool inObstacle);
+
+	//World space bounds of the wall or obstacle
+	FBox box;
+
+	//Whether the box belongs to an obstacle instead of a room wall
+	bool obstacle;
+};
+
+//Node of the hierarchy. Inner nodes have two children, leaves point to a range of boxes
+struct FCollisionBVHNode
+{
+	FCollisionBVHNode();
+
+	//Bounds of all boxes below this node
+	FBox bounds;
+
+	//Indices of the child nodes. INDEX_NONE for a leaf
+	int32 left;
+	int32 right;
+
+	//Range of boxes in a leaf
+	int32 first;
+	int32 count;
+};
+
+class FCollisionBVH
+{
+public:
+	FCollisionBVH();
+
+	//Removes all boxes
+	void reset();
+
+	//Builds the hierarchy over the given boxes, replacing the current contents
+	void build(const TArray<FCollisionBox>& inBoxes);
+
+	//Checks if a box with the given half extent, moved from start to end, hits any wall. Obstacles are only checked if includeObstacles is true
+	bool sweepBox(FVector start, FVector end, FVector extent, bool includeObstacles) const;
+
+	//Checks if the segment from start to end hits the box. If so, time is the fraction of the segment at which the box is entered
+	static bool intersectSegment(FVector start, FVector end, const FBox& box, float& time);
+
+	//Amount of boxes in the hierarchy
+	int32 num() const { return boxes.Num(); }
+
+private:
+	//Builds the subtree of the boxes from begin up to end and returns the index of its root
+	int32 buildRange(int32 begin, int32 end);
+
+	//All boxes, ordered such that every leaf points to a consecutive range
+	TArray<FCollisionBox> boxes;
+
+	//All nodes of the hierarchy. The root is the first node
+	TArray<FCollisionBVHNode> nodes;
+};
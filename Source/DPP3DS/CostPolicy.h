@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Utils.h"
+#include "Vertex.h"
+
+/**
+ * Cost policies for the path planning algorithms of the agents. The planners are templated on these policies, so the profile of an agent is chosen once per search instead of per neighbour
+ */
+
+//Checks if a surface type is part of the stairs
+inline bool isStairsSurface(ESurfaceType surface)
+{
+	return surface == ESurfaceType::Stairs || surface == ESurfaceType::StairsCeiling || surface == ESurfaceType::TransitionStairs;
+}
+
+//Agent that can only walk on floors and stairs. Uses the g and f values of the vertices and has no penalties
+struct FWalkerCostPolicy
+{
+	//Whether the agent can move onto a vertex with the given surface
+	bool canTraverse(ESurfaceType surface) const { return surface == ESurfaceType::Floor || surface == ESurfaceType::Stairs || surface == ESurfaceType::TransitionStairs; }
+
+	//Extra cost for moving from a vertex on surface from to a vertex on surface to
+	float getPenalty(ESurfaceType from, ESurfaceType to) const { return 0; }
+
+	//The g and f values this agent uses
+	float& getG(AVertex* vertex) const { return vertex->g; }
+	float& getF(AVertex* vertex) const { return vertex->f; }
+};
+
+//Agent that can climb on all surfaces. Uses the gC and fC values of the vertices
+struct FClimberCostPolicy
+{
+	//Penalty for moving to another surface
+	const float surfacePenalty = 400;
+
+	//Penalty for using the stairs as a climber
+	const float stairsPenalty = 400;
+
+	bool canTraverse(ESurfaceType surface) const { return true; }
+
+	float getPenalty(ESurfaceType from, ESurfaceType to) const { return (from != to ? surfacePenalty : 0) + (isStairsSurface(to) ? stairsPenalty : 0); }
+
+	float& getG(AVertex* vertex) const { return vertex->gC; }
+	float& getF(AVertex* vertex) const { return vertex->fC; }
+};
+
+//Agent that can climb on all surfaces with penalties taken from a penalty table. Uses the gC and fC values of the vertices
+struct FCustomCostPolicy
+{
+	FCustomCostPolicy(const FCostPenalties& inPenalties) : penalties(inPenalties) {}
+
+	//Penalty table of the agent
+	const FCostPenalties& penalties;
+
+	bool canTraverse(ESurfaceType surface) const { return true; }
+
+	float getPenalty(ESurfaceType from, ESurfaceType to) const
+	{
+		float returnValue = (from != to ? penalties.surfacePenalty : 0) + (isStairsSurface(to) ? penalties.stairsPenalty : 0);
+		if (const float* surfaceTypePenalty = penalties.surfaceTypePenalties.Find(to)) { returnValue += *surfaceTypePenalty; }
+		return returnValue;
+	}
+
+	float& getG(AVertex* vertex) const { return vertex->gC; }
+	float& getF(AVertex* vertex) const { return vertex->fC; }
+};
@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoverageRaster.h"
+
+//Largest amount of cells in a raster. Keeps the memory of a raster of a large surface with a small agent in check
+static const int64 MaxRasterCells = 16777216;
+
+//Limits the range of x for which coefficient * x + offset lies between low and high. Returns false if no x is left
+static bool clipLinear(float coefficient, float offset, float low, float high, float& inOutMin, float& inOutMax)
+{
+	if (FMath::Abs(coefficient) < KINDA_SMALL_NUMBER) { return offset >= low && offset <= high; }
+
+	float first = (low - offset) / coefficient;
+	float second = (high - offset) / coefficient;
+	inOutMin = FMath::Max(inOutMin, FMath::Min(first, second));
+	inOutMax = FMath::Min(inOutMax, FMath::Max(first, second));
+	return inOutMin <= inOutMax;
+}
+
+//Finds the part of the row at height y within radius of the segment from a to b. The capsule is convex, so this is a single span
+static bool findCapsuleSpan(FVector2D a, FVector2D b, float radius, float y, float& outMin, float& outMax)
+{
+	outMin = MAX_flt;
+	outMax = -MAX_flt;
+
+	//The round ends of the capsule
+	for (const FVector2D& end : { a, b }) {
+		float dy = y - end.Y;
+		if (dy * dy > radius * radius) { continue; }
+		float halfWidth = FMath::Sqrt(radius * radius - dy * dy);
+		outMin = FMath::Min(outMin, end.X - halfWidth);
+		outMax = FMath::Max(outMax, end.X + halfWidth);
+	}
+
+	//The rectangle along the segment: the projection on the segment lies on it and the distance to the line is at most the radius
+	FVector2D direction = b - a;
+	float length = direction.Size();
+	if (length > 0) {
+		FVector2D normal = FVector2D(-direction.Y, direction.X) / length;
+		float bodyMin = -MAX_flt;
+		float bodyMax = MAX_flt;
+		if (clipLinear(direction.X, (y - a.Y) * direction.Y - a.X * direction.X, 0, length * length, bodyMin, bodyMax) &&
+			clipLinear(normal.X, (y - a.Y) * normal.Y - a.X * normal.X, -radius, radius, bodyMin, bodyMax)) {
+			outMin = FMath::Min(outMin, bodyMin);
+			outMax = FMath::Max(outMax, bodyMax);
+		}
+	}
+
+	return outMin <= outMax;
+}
+
+FCoverageRaster::FCoverageRaster() { reset(); }
+
+void FCoverageRaster::reset()
+{
+	bounds = FBox2D(ForceInit);
+	cellSize = 1;
+	columns = 0;
+	rows = 0;
+	wordsPerRow = 0;
+	area.Empty();
+	covered.Empty();
+	areaCells = 0;
+	coveredCells = 0;
+}
+
+void FCoverageRaster::init(const FBox2D& inBounds, float inCellSize)
+{
+	reset();
+	if (!inBounds.bIsValid || inCellSize <= 0) { return; }
+
+	bounds = inBounds;
+	FVector2D size = bounds.GetSize();
+	cellSize = FMath::Max(inCellSize, FMath::Sqrt(size.X * size.Y / MaxRasterCells));
+	columns = FMath::Max(1, FMath::CeilToInt(size.X / cellSize));
+	rows = FMath::Max(1, FMath::CeilToInt(size.Y / cellSize));
+	wordsPerRow = (columns + 63) / 64;
+
+	area.SetNumZeroed(wordsPerRow * rows);
+	covered.SetNumZeroed(wordsPerRow * rows);
+}
+
+bool FCoverageRaster::findCellRange(const FBox2D& box, int32& outMinX, int32& outMinY, int32& outMaxX, int32& outMaxY) const
+{
+	//Cell y has its center at bounds.Min.Y + (y + 0.5) * cellSize
+	outMinY = FMath::Max(0, FMath::CeilToInt((box.Min.Y - bounds.Min.Y) / cellSize - 0.5f));
+	outMaxY = FMath::Min(rows - 1, FMath::FloorToInt((box.Max.Y - bounds.Min.Y) / cellSize - 0.5f));
+	return findColumnRange(box.Min.X, box.Max.X, outMinX, outMaxX) && outMinY <= outMaxY;
+}
+
+bool FCoverageRaster::findColumnRange(float minimum, float maximum, int32& outMinX, int32& outMaxX) const
+{
+	outMinX = FMath::Max(0, FMath::CeilToInt((minimum - bounds.Min.X) / cellSize - 0.5f));
+	outMaxX = FMath::Min(columns - 1, FMath::FloorToInt((maximum - bounds.Min.X) / cellSize - 0.5f));
+	return outMinX <= outMaxX;
+}
+
+int32 FCoverageRaster::fillSpan(TArray<uint64>& bits, const TArray<uint64>* mask, int32 row, int32 minX, int32 maxX)
+{
+	int32 newCells = 0;
+	int32 firstWord = minX >> 6;
+	int32 lastWord = maxX >> 6;
+
+	for (int32 w = firstWord; w <= lastWord; w++) {
+		//Bits of the span in this word
+		uint64 spanBits = ~0ull;
+		if (w == firstWord) { spanBits &= ~0ull << (minX & 63); }
+		if (w == lastWord) { spanBits &= ~0ull >> (63 - (maxX & 63)); }
+
+		int32 word = row * wordsPerRow + w;
+		if (mask) { spanBits &= (*mask)[word]; }
+
+		uint64 newBits = spanBits & ~bits[word];
+		bits[word] |= newBits;
+		newCells += FPlatformMath::CountBits(newBits);
+	}
+
+	return newCells;
+}
+
+void FCoverageRaster::addArea(const FBox2D& rectangle)
+{
+	int32 minX, minY, maxX, maxY;
+	if (!findCellRange(rectangle, minX, minY, maxX, maxY)) { return; }
+
+	for (int32 y = minY; y <= maxY; y++) { areaCells += fillSpan(area, nullptr, y, minX, maxX); }
+}
+
+int32 FCoverageRaster::addCapsule(FVector2D a, FVector2D b, float radius)
+{
+	int32 minX, minY, maxX, maxY;
+	FBox2D box(FVector2D(FMath::Min(a.X, b.X), FMath::Min(a.Y, b.Y)) - FVector2D(radius), FVector2D(FMath::Max(a.X, b.X), FMath::Max(a.Y, b.Y)) + FVector2D(radius));
+	if (!findCellRange(box, minX, minY, maxX, maxY)) { return 0; }
+
+	int32 newCells = 0;
+
+	//Fill the span of the capsule at the center of every row. Only cells that are part of the surface can be covered
+	for (int32 y = minY; y <= maxY; y++) {
+		float spanMin, spanMax;
+		int32 spanMinX, spanMaxX;
+		if (!findCapsuleSpan(a, b, radius, bounds.Min.Y + (y + 0.5f) * cellSize, spanMin, spanMax)) { continue; }
+		if (!findColumnRange(spanMin, spanMax, spanMinX, spanMaxX)) { continue; }
+		newCells += fillSpan(covered, &area, y, spanMinX, spanMaxX);
+	}
+
+	coveredCells += newCells;
+	return newCells;
+}
+
+float FCoverageRaster::coveredFraction() const { return areaCells > 0 ? (float)coveredCells / areaCells : 0; }
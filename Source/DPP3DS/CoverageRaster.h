@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Raster over the plane of a surface that keeps track of which part of the surface is covered by edges. Used to measure coverage while generating and after building.
+ * Cells are stored as bits, 64 to a word, so a span of a row is filled and counted a whole word at a time
+ */
+
+class FCoverageRaster
+{
+public:
+	FCoverageRaster();
+
+	//Removes all cells
+	void reset();
+
+	//Sets up an empty raster over the given bounds with square cells of the given size. The size is raised if the raster would get too many cells
+	void init(const FBox2D& inBounds, float inCellSize);
+
+	//Marks the cells with their center in the rectangle as part of the surface
+	void addArea(const FBox2D& rectangle);
+
+	//Marks the cells of the surface within radius of the segment from a to b as covered. Returns the amount of cells that were not covered yet
+	int32 addCapsule(FVector2D a, FVector2D b, float radius);
+
+	//Covered part of the surface, between 0 and 1
+	float coveredFraction() const;
+
+	//Covered area and total area of the surface
+	float coveredArea() const { return coveredCells * cellSize * cellSize; }
+	float totalArea() const { return areaCells * cellSize * cellSize; }
+
+private:
+	//Finds the range of cells whose centers are in the box. Returns false if there are none
+	bool findCellRange(const FBox2D& box, int32& outMinX, int32& outMinY, int32& outMaxX, int32& outMaxY) const;
+
+	//Finds the columns whose centers lie between minimum and maximum. Returns false if there are none
+	bool findColumnRange(float minimum, float maximum, int32& outMinX, int32& outMaxX) const;
+
+	//Sets the bits of the cells from minX to maxX in the row, limited to the mask if one is given. Returns the amount of bits that were not set yet
+	int32 fillSpan(TArray<uint64>& bits, const TArray<uint64>* mask, int32 row, int32 minX, int32 maxX);
+
+	FBox2D bounds;
+	float cellSize;
+	int32 columns;
+	int32 rows;
+	int32 wordsPerRow;
+
+	//Per cell whether it is part of the surface and whether it is covered, one bit per cell and row after row
+	TArray<uint64> area;
+	TArray<uint64> covered;
+
+	int32 areaCells;
+	int32 coveredCells;
+};
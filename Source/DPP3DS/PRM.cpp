@@ -6,6 +6,10 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "DrawDebugHelpers.h"
 #include "BasicRoom.h"
+#include "Async/ParallelFor.h"
+
+//Half of the size of the cube of a vertex
+static const float VERTEX_HALF_SIZE = 4.5f;
 
 // Sets default values
 APRM::APRM()
@@ -13,6 +17,37 @@ APRM::APRM()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
+	vertexTree = nullptr;
+	collisionBVH = nullptr;
+	obstaclesBlockEdges = false;
+	lazyEdges = false;
+	parallelEdgeTraces = true;
+	poissonDisk = false;
+	tracedCandidates = 0;
+	componentEdges = false;
+	skippedCandidates = 0;
+	narrowPassageShare = 0;
+	biasedVertices = 0;
+}
+
+FPlannedEdge::FPlannedEdge(AVertex* inA, AVertex* inB, bool inConnection, bool inCheckExists, bool inUnchecked)
+{
+	a = inA;
+	b = inB;
+	connection = inConnection;
+	checkExists = inCheckExists;
+	unchecked = inUnchecked;
+}
+
+FEdgeCandidate::FEdgeCandidate(AVertex* inA, AVertex* inB)
+{
+	a = inA;
+	b = inB;
+	locationA = inA->GetActorLocation();
+	locationB = inB->GetActorLocation();
+	blocked = true;
+	overVoid = false;
+	analytic = false;
 }
 
 // Called when the game starts or when spawned
@@ -24,6 +59,7 @@ void APRM::Tick(float DeltaTime) { Super::Tick(DeltaTime); }
 void APRM::removePRM() {
 	vertices.Empty();
 	edges.Empty();
+	edgeIndex.Empty();
 }
 
 void APRM::calculateWeights() {
@@ -48,6 +84,7 @@ void APRM::calculateWeights() {
 	}
 
 	totalSize = surfaceSize;
+	surfaceTable.build(weights);
 }
 
 void APRM::hidePRM() {
@@ -60,13 +97,17 @@ void APRM::showPRM() {
 	for (APRMEdge* edge : edges) { if (edge) { edge->showEdge(); } }
 }
 
-float APRM::calculateCoverSize(float agentSize) { 
-	float returnValue = 0;
+float APRM::calculateCoverSize(float agentSize, float cellSize, const TMap<ESurfaceType, TArray<APRMEdge*>>& typeEdges) { 
+	coverSize = 0;
 
-	//Calculate the cover size of each surface and add it to the result
-	for (ASurfaceArea* surface : surfaces) { returnValue += surface->calculateCoverSize(agentSize); }
+	//Calculate the cover size of each surface from the edges of its type and add it to the result
+	for (ASurfaceArea* surface : surfaces) {
+		if (!surface) { continue; }
+		const TArray<APRMEdge*>* surfaceEdges = typeEdges.Find(surface->surface);
+		coverSize += surfaceEdges ? surface->calculateCoverSize(agentSize, cellSize, *surfaceEdges) : 0;
+	}
 
-	return returnValue;
+	return coverSize;
 }
 
 void APRM::setVertexCount(float inverseVertexDensity) {
@@ -113,19 +154,84 @@ int32 APRM::generateRandomVertices(int32 startID, float agentSize, bool apsmo, b
 		}
 	}
 
+	//Spread the remaining vertices evenly instead of placing them one by one
+	if (poissonDisk) { return generatePoissonVertices(newID, agentSize, vertexCount - verticesGenerated); }
+
 	// Loop until vertexCount vertices have been created, if the optional stuff beforehand didn't do so already.
 	// Do note that we TRY to create vertexCount vertices. If one cannot be generated, we generate one less.
 	for (int i = verticesGenerated; i < vertexCount; i++) {
 		//Find a surface to generate a vertex on
 		ASurfaceArea* selectedSurface = selectRandomSurface();
 
-		//Generate the vertex
-		newID = generateVertex(newID, selectedSurface, agentSize);
+		//Generate the vertex, near a narrow passage or transition for part of the vertices
+		if (narrowPassageShare > 0 && random.frand() < narrowPassageShare) { newID = generateBiasedVertex(newID, selectedSurface, agentSize); }
+		else { newID = generateVertex(newID, selectedSurface, agentSize); }
+	}
+
+	return newID;
+}
+
+int32 APRM::generatePoissonVertices(int32 startID, float agentSize, int32 count)
+{
+	int32 newID = startID;
+	if (count <= 0) { return newID; }
+
+	for (int32 i = 0; i < surfaces.Num(); i++) {
+		ASurfaceArea* surface = surfaces[i];
+		if (!surface || !weights.IsValidIndex(i)) { continue; }
+
+		//Each surface gets its share of the vertices by weight, with at least one vertex
+		TArray<FVector> locations;
+		surface->findPoissonLocations(agentSize, FMath::Max(1, FMath::RoundToInt(count * weights[i])), locations);
+
+		for (const FVector& location : locations) {
+			//Vertices of the subsurface options or of neighbouring surfaces may already be close to the location
+			if (vertexTree && vertexTree->hasVertexWithin(location, agentSize)) { continue; }
+			if (surface->isInObstacle(location, agentSize) || surface->isInOtherSurface(location)) { continue; }
+
+			AVertex* newVertex = surface->generateVertexAtLocation(newID, agentSize, location, false);
+			if (newVertex != nullptr) {
+				vertices.AddUnique(newVertex);
+				if (vertexTree) { vertexTree->insert(newVertex); }
+				newID++;
+			}
+		}
 	}
 
 	return newID;
 }
 
+int32 APRM::generateAdaptiveVertices(int32 startID, float agentSize, int32 count, const TSet<ASurfaceArea*>& activeSurfaces)
+{
+	int32 newID = startID;
+
+	for (int32 i = 0; i < surfaces.Num(); i++) {
+		if (!activeSurfaces.Contains(surfaces[i]) || !weights.IsValidIndex(i)) { continue; }
+
+		//Each active surface gets its share of the vertices by weight, with at least one vertex
+		int32 surfaceCount = FMath::Max(1, FMath::RoundToInt(count * weights[i]));
+		for (int32 j = 0; j < surfaceCount; j++) {
+			if (narrowPassageShare > 0 && random.frand() < narrowPassageShare) { newID = generateBiasedVertex(newID, surfaces[i], agentSize); }
+			else { newID = generateVertex(newID, surfaces[i], agentSize); }
+		}
+	}
+
+	return newID;
+}
+
+void APRM::addEdgeCoverage(int32 firstEdge, float agentSize)
+{
+	for (int32 i = FMath::Max(firstEdge, 0); i < edges.Num(); i++) {
+		APRMEdge* edge = edges[i];
+		if (!edge || !edge->spline) { continue; }
+
+		//The raster of each surface only counts the part of the footprint that lies on that surface
+		FVector start = edge->GetActorLocation();
+		FVector end = start + edge->spline->GetEndPosition();
+		for (ASurfaceArea* surface : surfaces) { if (surface && surface->surface == edge->surface) { surface->addEdgeCoverage(start, end, agentSize); } }
+	}
+}
+
 int32 APRM::generateApproximateMedialVertices(int32 startID, float agentSize)
 {
 	//ID for the new vertex
@@ -139,11 +245,7 @@ int32 APRM::generateApproximateMedialVertices(int32 startID, float agentSize)
 		//Find a location on a surface to generate a vertex on
 		ASurfaceArea* selectedSurface = selectRandomSurface();
 
-		if (selectedSurface) {
-			UStaticMeshComponent* selectedCube = selectedSurface->getRandomCube();
-
-			if (selectedCube) { location = selectedSurface->getRandomSpawnLocation(selectedCube);  }
-		}
+		if (selectedSurface) { selectedSurface->getSampleLocation(location); }
 
 		//Move this location towards the medial axis
 		bool canGenerate = false;
@@ -385,32 +487,12 @@ bool APRM::checkIfInSurface(AVertex * vertex, ASurfaceArea * surface)
 }
 
 ASurfaceArea* APRM::selectRandomSurface() {
-	//The surface area that will be returned
-	ASurfaceArea* returnValue = nullptr;
-
-	//Find a random number between 0 and 1
-	float random = FMath::FRandRange(0, 1);
-
-	//Create an array with the sum of the weights per surface, so surface A has weight a, B has a + b, etc. Last surface has a + b + ... = 1.
-	TArray<float> sumOfWeights;
+	//The table is not saved with the level, so build it again if it does not match the weights
+	if (surfaceTable.num() != weights.Num()) { surfaceTable.build(weights); }
 
-	for (int i = 0; i < weights.Num(); i++) {
-		float sumWeight = weights[i];
-
-		//Except for the first item, add the weight of the previous sum
-		if (i > 0) { sumWeight += sumOfWeights[i - 1]; }
-		sumOfWeights.Add(sumWeight);
-	}
-
-	//Then select the lowest index j such that random <= weight at j
-	for (int j = 0; j < sumOfWeights.Num(); j++) {
-		if (random <= sumOfWeights[j]) {
-			returnValue = surfaces[j];
-			break;
-		}
-	}
-
-	return returnValue;
+	//Draw a surface with a chance equal to its weight
+	int32 index = surfaceTable.sample(random);
+	return surfaces.IsValidIndex(index) ? surfaces[index] : nullptr;
 }
 
 int32 APRM::generateVertex(int32 startID, ASurfaceArea* surface, float agentSize) {
@@ -433,12 +515,31 @@ int32 APRM::generateVertex(int32 startID, ASurfaceArea* surface, float agentSize
 	//Add the new vertex to the vertices array and increase the id, if a new vertex has been created
 	if (newVertex != nullptr) {
 		vertices.AddUnique(newVertex);
+		if (vertexTree) { vertexTree->insert(newVertex); }
 		newID++;
 	}
 
 	return newID;
 }
 
+int32 APRM::generateBiasedVertex(int32 startID, ASurfaceArea* surface, float agentSize) {
+	//Most bridge tests fail, so try a few times before falling back to a regular vertex. Each try can take three overlap queries without freeSpaceSampling
+	int32 tries = 0;
+	int32 newID = startID;
+	AVertex* newVertex = nullptr;
+	while (newVertex == nullptr && tries < 10) {
+		newVertex = surface->generateBiasedVertex(newID, agentSize, false);
+		tries++;
+	}
+
+	if (newVertex == nullptr) { return generateVertex(startID, surface, agentSize); }
+
+	vertices.AddUnique(newVertex);
+	if (vertexTree) { vertexTree->insert(newVertex); }
+	biasedVertices++;
+	return newID + 1;
+}
+
 int32 APRM::generateVertexAtLocation(int32 startID, ASurfaceArea* surface, FVector location, float agentSize)
 {
 	//For the sake of preventing infinite loops
@@ -451,6 +552,7 @@ int32 APRM::generateVertexAtLocation(int32 startID, ASurfaceArea* surface, FVect
 	//Add the new vertex to the vertices array and increase the id, if a new vertex has been created
 	if (newVertex != nullptr) {
 		vertices.AddUnique(newVertex);
+		if (vertexTree) { vertexTree->insert(newVertex); }
 		newID++;
 	}
 
@@ -478,64 +580,101 @@ int32 APRM::generateVertexInSubsurface(int32 startID, ASurfaceArea* surface, int
 
 	if (newVertex != nullptr) {
 		vertices.AddUnique(newVertex);
+		if (vertexTree) { vertexTree->insert(newVertex); }
 		newID++;
 	}
 
 	return newID;
 }
 
-int32 APRM::generateEdges(int32 startID, float agentSize, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, bool knn, bool knn3d) {
-	int edgeID = startID;
-	outConnections = inConnections;
+int32 APRM::generateEdges(int32 startID, float agentSize, FPRMConnectionSet& connections, bool knn, bool knn3d) {
+	planEdges(agentSize, knn, knn3d, 0);
+	return commitEdges(startID, connections);
+}
+
+void APRM::planEdges(float agentSize, bool knn, bool knn3d, int32 firstVertex) {
+	plannedEdges.Reset();
+
+	//Keep track of the time and the amount of traced candidates, so the speedup of the parallel traces can be measured per PRM
+	FDateTime startTime = FDateTime::Now();
+	tracedCandidates = 0;
+	skippedCandidates = 0;
+
+	//Find which vertices the existing edges already connect, so only edges that join two parts are traced
+	if (componentEdges) {
+		componentIndices.Empty(vertices.Num());
+		for (int32 v = 0; v < vertices.Num(); v++) { if (vertices[v]) { componentIndices.Add(vertices[v]->id, v); } }
+		components.init(vertices.Num());
+		for (APRMEdge* edge : edges) {
+			if (!edge || edge->endVertices.Num() < 2) { continue; }
+			const int32* a = componentIndices.Find(edge->endVertices[0]);
+			const int32* b = componentIndices.Find(edge->endVertices[1]);
+			if (a && b) { components.merge(*a, *b); }
+		}
+	}
 
-	//Indicate that no vertex has been checked yet
-	TArray<AVertex*> checkedVertices = {};
-	TArray<AVertex*> uncheckedVertices;
-	for (AVertex* vertex : vertices) { uncheckedVertices.AddUnique(vertex);	}
+	//Lazy edges are only made to neighbours in this PRM
+	if (lazyEdges) {
+		vertexSet.Empty(vertices.Num());
+		vertexSet.Append(vertices);
+	}
 
-	//Add edges to every vertex
-	for (AVertex* vertex : vertices) {
-		if (uncheckedVertices.Num() > 0) {
-			//Pick the first vertex in the vertex array, which is different for every loop
-			AVertex* baseVertex = uncheckedVertices[0];
+	//Indicate that no vertex has been checked yet. A set, so looking up whether a vertex was checked does not depend on the amount of vertices
+	TSet<AVertex*> checkedVertices;
+	checkedVertices.Reserve(vertices.Num());
+	const TSet<AVertex*> empty;
+	TArray<AVertex*> possibleNeighbours;
+
+	//Add edges to every vertex from the first vertex on. Earlier vertices already have their edges
+	for (int32 v = FMath::Max(firstVertex, 0); v < vertices.Num(); v++) {
+		AVertex* baseVertex = vertices[v];
+		if (!checkedVertices.Contains(baseVertex)) {
+			//Handle the vertices in the order of the vertex array
 			baseVertex->possibleNeighbours.Empty();
-			uncheckedVertices.Remove(baseVertex);
-			TArray<AVertex*> possibleNeighbours;
+			possibleNeighbours.Reset();
 			
 			//Find either all vertices in a close area, or the K-nearest neighbours on the plane, or the K-nearest neighbours in 3D
 			if (knn3d) {
-				TArray<AVertex*> empty;
-
 				//Find the extent of the overlap box to check for neighbours
 				FVector extent = FVector(5000);
-				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, empty);
-
-				//Sort the neighbours so that the nearest neighbour is first in the array
-				Algo::SortBy(possibleNeighbours, [&](AVertex* vertexA)
-				{
-					const float& distance = (vertexA->GetActorLocation() - baseVertex->GetActorLocation()).Size();
-					return distance;
-				});
+				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, empty, true);
 
 				int32 edgesGenerated = 0;
+				int32 nextNeighbour = 0;
+
+				//In the lazy mode, the nearest neighbours in this PRM get an unchecked edge. Only the neighbours in other PRMs are traced, since they may need a connection
+				if (lazyEdges) {
+					TArray<AVertex*> otherNeighbours;
+					edgesGenerated = generateLazyEdges(baseVertex, possibleNeighbours, edgeCount3D, true, otherNeighbours);
+					possibleNeighbours = MoveTemp(otherNeighbours);
+				}
+
+				//Only trace the neighbours that join two parts of the PRM, then skip the regular traces
+				if (componentEdges) {
+					edgesGenerated += planComponentEdges(baseVertex, possibleNeighbours, edgeCount3D - edgesGenerated, true, agentSize);
+					nextNeighbour = possibleNeighbours.Num();
+				}
 
 				//Create an edge between two vertices if not blocked and not over a hole. Also make sure, since it's KNN, that 
-				if (edgesGenerated < edgeCount3D) {
-					for (AVertex* neighbour : possibleNeighbours) {
+				while (edgesGenerated < edgeCount3D && nextNeighbour < possibleNeighbours.Num()) {
+					//Trace as many candidates at once as there are edges left to generate
+					TArray<FEdgeCandidate> candidates = traceEdgeCandidates(baseVertex, possibleNeighbours, nextNeighbour, edgeCount3D - edgesGenerated, agentSize);
+					nextNeighbour += candidates.Num();
+
+					//Handle the candidates in the order of the neighbours, so the result does not depend on the order the traces finished in
+					for (const FEdgeCandidate& candidate : candidates) {
+						AVertex* neighbour = candidate.b;
+
 						//Direct connection between two vertices on the same plane (the surfaces of this PRM)
-						if (!isEdgeBlocked(baseVertex, neighbour, agentSize) && !isEdgeOverVoid(baseVertex->GetActorLocation(), neighbour->GetActorLocation())) {
-							if (!doesEdgeExist(baseVertex, neighbour)) {
-								generateEdge(baseVertex, neighbour, edgeID, baseVertex->surface, false);
-								edgeID++;
-							}
+						if (candidate.isValid()) {
+							plannedEdges.Add(FPlannedEdge(baseVertex, neighbour, false, true, false));
 							edgesGenerated++;
 						}
 						//If the vertices are not on the same PRM and they are not helper vertices, connect them later on and for now indicate that they should be connected.
 						else if (!vertices.Contains(neighbour) && neighbour->GetClass() != AHelperVertex::StaticClass()) {
 							//Check if the neighbour is in a neighbouring surface
 							if (checkNeighbouringSurfaces(baseVertex, neighbour)) {
-								FPRMConnection connection = FPRMConnection(baseVertex, neighbour);
-								outConnections.Add(connection);
+								plannedEdges.Add(FPlannedEdge(baseVertex, neighbour, true, false, false));
 								edgesGenerated++;
 								baseVertex->possibleNeighbours.AddUnique(neighbour->id);
 							}
@@ -547,8 +686,6 @@ int32 APRM::generateEdges(int32 startID, float agentSize, TArray<FPRMConnection>
 				}
 			}
 			else if (knn) {
-				TArray<AVertex*> empty;
-
 				//Find the extent of the overlap box to check for neighbours
 				FVector extent = FVector(7500);
 				switch (baseVertex->surface) {
@@ -579,25 +716,33 @@ int32 APRM::generateEdges(int32 startID, float agentSize, TArray<FPRMConnection>
 				default:
 					break;
 				}
-				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, empty);
-
-				//Sort the neighbours so that the nearest neighbour is first in the array
-				Algo::SortBy(possibleNeighbours, [&](AVertex* vertexA)
-				{
-					const float& distance = (vertexA->GetActorLocation() - baseVertex->GetActorLocation()).Size();
-					return distance;
-				});
+				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, empty, true);
 
 				int32 edgesGenerated = 0;
+				int32 nextNeighbour = 0;
+
+				//In the lazy mode, the nearest neighbours get an unchecked edge. Only the neighbours that are left over are traced
+				if (lazyEdges) {
+					TArray<AVertex*> otherNeighbours;
+					edgesGenerated = generateLazyEdges(baseVertex, possibleNeighbours, edgeCount, false, otherNeighbours);
+					possibleNeighbours = MoveTemp(otherNeighbours);
+				}
+
+				//Only trace the neighbours that join two parts of the PRM, then skip the regular traces
+				if (componentEdges) {
+					edgesGenerated += planComponentEdges(baseVertex, possibleNeighbours, edgeCount - edgesGenerated, false, agentSize);
+					nextNeighbour = possibleNeighbours.Num();
+				}
 
 				//Create an edge between two vertices if not blocked and not over a hole. Also make sure, since it's KNN, that 
-				if (edgesGenerated < edgeCount) {
-					for (AVertex* neighbour : possibleNeighbours) {
-						if (!isEdgeBlocked(baseVertex, neighbour, agentSize) && !isEdgeOverVoid(baseVertex->GetActorLocation(), neighbour->GetActorLocation())) {
-							if (!doesEdgeExist(baseVertex, neighbour)) {
-								generateEdge(baseVertex, neighbour, edgeID, baseVertex->surface, false);
-								edgeID++;
-							}
+				while (edgesGenerated < edgeCount && nextNeighbour < possibleNeighbours.Num()) {
+					//Trace as many candidates at once as there are edges left to generate
+					TArray<FEdgeCandidate> candidates = traceEdgeCandidates(baseVertex, possibleNeighbours, nextNeighbour, edgeCount - edgesGenerated, agentSize);
+					nextNeighbour += candidates.Num();
+
+					for (const FEdgeCandidate& candidate : candidates) {
+						if (candidate.isValid()) {
+							plannedEdges.Add(FPlannedEdge(baseVertex, candidate.b, false, true, false));
 							edgesGenerated++;
 						}
 
@@ -637,34 +782,80 @@ int32 APRM::generateEdges(int32 startID, float agentSize, TArray<FPRMConnection>
 				default:
 					break;
 				}
-				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, checkedVertices);
+				possibleNeighbours = findAllNearbyNeighbours(baseVertex, extent, checkedVertices, false);
 
-				//Create an edge between two vertices if not blocked and not over a hole
-				for (AVertex* neighbour : possibleNeighbours) {
-					if (!isEdgeBlocked(baseVertex, neighbour, agentSize) && !isEdgeOverVoid(baseVertex->GetActorLocation(), neighbour->GetActorLocation())) {
-						generateEdge(baseVertex, neighbour, edgeID, baseVertex->surface, false);
-						edgeID++;
-					}
+				//In the lazy mode, every nearby vertex gets an unchecked edge. Only the neighbours that are left over are traced
+				if (lazyEdges) {
+					TArray<AVertex*> otherNeighbours;
+					generateLazyEdges(baseVertex, possibleNeighbours, possibleNeighbours.Num(), false, otherNeighbours);
+					possibleNeighbours = MoveTemp(otherNeighbours);
+				}
+
+				//Only trace the neighbours that join two parts of the PRM. Without a KNN limit, every nearby vertex may get an edge
+				if (componentEdges) {
+					planComponentEdges(baseVertex, possibleNeighbours, possibleNeighbours.Num(), false, agentSize);
+					possibleNeighbours.Empty();
+				}
+
+				//Create an edge between two vertices if not blocked and not over a hole. All candidates are traced at once
+				TArray<FEdgeCandidate> candidates = traceEdgeCandidates(baseVertex, possibleNeighbours, 0, possibleNeighbours.Num(), agentSize);
+				for (const FEdgeCandidate& candidate : candidates) {
+					if (candidate.isValid()) { plannedEdges.Add(FPlannedEdge(baseVertex, candidate.b, false, false, false)); }
 				}
 			}
 
 			//The base vertex does not need to be checked anymore
-			checkedVertices.AddUnique(baseVertex);
+			checkedVertices.Add(baseVertex);
+		}
+	}
+
+	//Report how long generating the edges took for this PRM
+	edgeTime = FDateTime::Now() - startTime;
+	UE_LOG(LogTemp, Log, TEXT("PRM %d: edges generated in %s with %d traced candidates"), id, *edgeTime.ToString(), tracedCandidates);
+	if (componentEdges) { UE_LOG(LogTemp, Log, TEXT("PRM %d: %d candidates skipped since their vertices were already connected"), id, skippedCandidates); }
+}
+
+int32 APRM::commitEdges(int32 startID, FPRMConnectionSet& connections) {
+	int32 edgeID = startID;
+
+	//Create everything in the planned order, so the IDs are the same as when the edges were created while planning
+	for (const FPlannedEdge& planned : plannedEdges) {
+		if (planned.connection) { connections.add(planned.a, planned.b); }
+		else if (!planned.checkExists || !doesEdgeExist(planned.a, planned.b)) {
+			APRMEdge* newEdge = generateEdge(planned.a, planned.b, edgeID, planned.a->surface, false);
+			if (newEdge) { newEdge->unchecked = planned.unchecked; }
+			edgeID++;
 		}
 	}
+	plannedEdges.Empty();
 
 	return edgeID;
 }
 
-TArray<AVertex*> APRM::findAllNearbyNeighbours(AVertex* baseVertex, FVector extent, TArray<AVertex*> checkedVertices) {
+TArray<AVertex*> APRM::findAllNearbyNeighbours(AVertex* baseVertex, FVector extent, const TSet<AVertex*>& checkedVertices, bool sortByDistance) {
 	//Overlapped vertices
 	TArray<AVertex*> returnValue;
+
+	//Use the spatial index if there is one, so the physics scene is not queried
+	if (vertexTree) {
+		TArray<AVertex*> found;
+		if (sortByDistance) { vertexTree->findNearestInBox(baseVertex->GetActorLocation(), extent, found); }
+		else { vertexTree->findInBox(baseVertex->GetActorLocation(), extent, found); }
+
+		//Skip the vertex itself and the vertices that have already been checked. The tree holds every vertex once, so no duplicates have to be removed
+		returnValue.Reserve(found.Num());
+		for (AVertex* vertex : found) { if (vertex != baseVertex && !checkedVertices.Contains(vertex)) { returnValue.Add(vertex); } }
+
+		return returnValue;
+	}
+
 	TArray<AActor*> tempActors;
 	
 	//Actors to ignore, so the vertex itself
 	TArray<AActor*> ignores;
+	ignores.Reserve(checkedVertices.Num() + 1);
 	ignores.Add(baseVertex);
-	ignores.Append(checkedVertices);
+	for (AVertex* vertex : checkedVertices) { ignores.Add(vertex); }
 
 	//Object types to trace
 	TArray<TEnumAsByte<EObjectTypeQuery>> traceObjectTypes;
@@ -676,97 +867,202 @@ TArray<AVertex*> APRM::findAllNearbyNeighbours(AVertex* baseVertex, FVector exte
 	//Cast to vertices and add to the result array
 	for (AActor* actor : tempActors) { returnValue.AddUnique((AVertex*)actor); }
 
+	//Sort the neighbours so that the nearest neighbour is first in the array
+	if (sortByDistance) {
+		Algo::SortBy(returnValue, [&](AVertex* vertexA)
+		{
+			const float& distance = (vertexA->GetActorLocation() - baseVertex->GetActorLocation()).Size();
+			return distance;
+		});
+	}
+
 	return returnValue;
 }
 
 bool APRM::isEdgeBlocked(AVertex* a, AVertex* b, float agentSize) {
-	//Start and end of the trace
-	FVector traceStartBase = a->GetActorLocation();
-	FVector traceEndBase = b->GetActorLocation();
-	FVector traceStart = traceStartBase;
-	FVector traceEnd = traceEndBase;
-	float offset = agentSize - 4;
-
-	//Add an offset to the start and end points such that the surface that the vertices are on are not used in computing whether there is a blocked edge
-	switch (a->surface) {
-	case ESurfaceType::Floor:
-		traceStart += FVector(0, 0, offset);
-		break;
-	case ESurfaceType::Ceiling:
-		traceStart += FVector(0, 0, -offset);
-		break;
-	case ESurfaceType::NorthWall:
-		traceStart += FVector(-offset, 0, 0);
-		break;
-	case ESurfaceType::SouthWall:
-		traceStart += FVector(offset, 0, 0);
-		break;
-	case ESurfaceType::EastWall:
-		traceStart += FVector(0, -offset, 0);
-		break;
-	case ESurfaceType::WestWall:
-		traceStart += FVector(0, offset, 0);
-		break;
-	case ESurfaceType::Stairs:
-		traceStart += FVector(0, 0, offset);
-		break;
-	case ESurfaceType::StairsCeiling:
-		traceStart += FVector(0, 0, -offset);
-		break;
-	default:
-		break;
-	}
-	switch (b->surface) {
-	case ESurfaceType::Floor:
-		traceEnd += FVector(0, 0, offset);
-		break;
-	case ESurfaceType::Ceiling:
-		traceEnd += FVector(0, 0, -offset);
-		break;
-	case ESurfaceType::NorthWall:
-		traceEnd += FVector(-offset, 0, 0);
-		break;
-	case ESurfaceType::SouthWall:
-		traceEnd += FVector(offset, 0, 0);
-		break;
-	case ESurfaceType::EastWall:
-		traceEnd += FVector(0, -offset, 0);
-		break;
-	case ESurfaceType::WestWall:
-		traceEnd += FVector(0, offset, 0);
-		break;
-	case ESurfaceType::Stairs:
-		traceEnd += FVector(0, 0, offset);
-		break;
-	case ESurfaceType::StairsCeiling:
-		traceEnd += FVector(0, 0, -offset);
-		break;
-	default:
-		break;
-	}
+	//Without the physics scene if possible
+	if (collisionBVH && vertexTree) { return isEdgeBlockedAnalytic(a, b, a->GetActorLocation(), b->GetActorLocation(), agentSize); }
 
 	//Output array
 	FHitResult roomHit;
 	TArray<FHitResult> vertexHits;
 
-	//Actors to ignore
-	TArray<AActor*> ignores;
+	//Do a box trace from a to b with the size of the mobile agent and a line trace to find the vertices in between
+	traceEdgeBlocked(a->GetActorLocation(), b->GetActorLocation(), a->surface, b->surface, agentSize, roomHit, vertexHits);
 
-	//Object types to trace
-	TArray<TEnumAsByte<EObjectTypeQuery>> traceObjectTypesLine;
-	traceObjectTypesLine.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldStatic));
+	return isBlockedByHits(roomHit, vertexHits, b);
+}
+
+TArray<FEdgeCandidate> APRM::traceEdgeCandidates(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 first, int32 count, float agentSize)
+{
+	//Gather the candidates on the game thread, so the workers don't read the actors
+	TArray<FEdgeCandidate> candidates;
+	int32 last = FMath::Min(first + count, neighbours.Num());
+	candidates.Reserve(FMath::Max(last - first, 0));
+	for (int32 i = first; i < last; i++) { candidates.Add(FEdgeCandidate(baseVertex, neighbours[i])); }
+
+	//The traces only read the physics scene, so they can run at the same time. Their hits are checked on this thread afterwards
+	ParallelFor(candidates.Num(), [&](int32 i) { traceCandidateBlocked(candidates[i], agentSize); }, !parallelEdgeTraces);
+	for (FEdgeCandidate& candidate : candidates) { checkCandidateBlocked(candidate); }
+	ParallelFor(candidates.Num(), [&](int32 i) { traceCandidateOverVoid(candidates[i]); }, !parallelEdgeTraces);
+	for (FEdgeCandidate& candidate : candidates) { checkCandidateOverVoid(candidate); }
+	tracedCandidates += candidates.Num();
+
+	return candidates;
+}
+
+int32 APRM::planComponentEdges(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 maxEdges, bool connectOthers, float agentSize)
+{
+	int32 edgesGenerated = 0;
+	const int32* baseIndex = componentIndices.Find(baseVertex->id);
+	if (!baseIndex) { return edgesGenerated; }
+
+	TArray<AVertex*> remaining = neighbours;
+	TArray<AVertex*> batch;
+	TArray<AVertex*> later;
+	TSet<int32> batchComponents;
+
+	while (edgesGenerated < maxEdges && remaining.Num() > 0) {
+		//Take the nearest remaining neighbour of every part the base vertex is not connected to. Neighbours of the same part wait for the next batch, since the first may connect them already
+		//A batch holds at most as many neighbours as there are edges left, so no more traces are done than without this option
+		int32 baseComponent = components.find(*baseIndex);
+		int32 batchSize = maxEdges - edgesGenerated;
+		batch.Reset();
+		later.Reset();
+		batchComponents.Reset();
+		for (AVertex* neighbour : remaining) {
+			const int32* neighbourIndex = componentIndices.Find(neighbour->id);
+			int32 neighbourComponent = neighbourIndex ? components.find(*neighbourIndex) : INDEX_NONE;
+			if (neighbourIndex && neighbourComponent == baseComponent) { skippedCandidates++; }
+			else if (batch.Num() >= batchSize) { later.Add(neighbour); }
+			else if (!neighbourIndex) { batch.Add(neighbour); }
+			else if (batchComponents.Contains(neighbourComponent)) { later.Add(neighbour); }
+			else {
+				batchComponents.Add(neighbourComponent);
+				batch.Add(neighbour);
+			}
+		}
+
+		//Handle the candidates in the order of the neighbours, so the result does not depend on the order the traces finished in
+		TArray<FEdgeCandidate> candidates = traceEdgeCandidates(baseVertex, batch, 0, batch.Num(), agentSize);
+		for (const FEdgeCandidate& candidate : candidates) {
+			const int32* neighbourIndex = componentIndices.Find(candidate.b->id);
+			if (candidate.isValid()) {
+				if (neighbourIndex) { components.merge(*baseIndex, *neighbourIndex); }
+				plannedEdges.Add(FPlannedEdge(baseVertex, candidate.b, false, true, false));
+				edgesGenerated++;
+			}
+			else if (connectOthers && !neighbourIndex && candidate.b->GetClass() != AHelperVertex::StaticClass() && checkNeighbouringSurfaces(baseVertex, candidate.b)) {
+				plannedEdges.Add(FPlannedEdge(baseVertex, candidate.b, true, false, false));
+				baseVertex->possibleNeighbours.AddUnique(candidate.b->id);
+				edgesGenerated++;
+			}
+
+			if (edgesGenerated >= maxEdges) { break; }
+		}
+
+		Swap(remaining, later);
+	}
+
+	return edgesGenerated;
+}
+
+void APRM::traceEdgeCandidate(FEdgeCandidate& candidate, float agentSize) const
+{
+	traceCandidateBlocked(candidate, agentSize);
+	checkCandidateBlocked(candidate);
+	traceCandidateOverVoid(candidate);
+	checkCandidateOverVoid(candidate);
+}
+
+void APRM::traceCandidateBlocked(FEdgeCandidate& candidate, float agentSize) const
+{
+	//Without the physics scene if possible, which needs no hits to be checked
+	if (collisionBVH && vertexTree) {
+		candidate.blocked = isEdgeBlockedAnalytic(candidate.a, candidate.b, candidate.locationA, candidate.locationB, agentSize);
+		candidate.analytic = true;
+	}
+	else { traceEdgeBlocked(candidate.locationA, candidate.locationB, candidate.a->surface, candidate.b->surface, agentSize, candidate.roomHit, candidate.vertexHits); }
+}
+
+void APRM::traceCandidateOverVoid(FEdgeCandidate& candidate) const
+{
+	//Only check for holes if the edge is not blocked
+	if (!candidate.blocked) { traceEdgeOverVoid(candidate.locationA, candidate.locationB, candidate.hitsAB, candidate.hitsBA); }
+}
+
+void APRM::checkCandidateBlocked(FEdgeCandidate& candidate)
+{
+	if (!candidate.analytic) { candidate.blocked = isBlockedByHits(candidate.roomHit, candidate.vertexHits, candidate.b); }
+	candidate.vertexHits.Empty();
+}
+
+void APRM::checkCandidateOverVoid(FEdgeCandidate& candidate)
+{
+	if (!candidate.blocked) { candidate.overVoid = isOverVoidByHits(candidate.hitsAB, candidate.hitsBA); }
+	candidate.hitsAB.Empty();
+	candidate.hitsBA.Empty();
+}
+
+bool APRM::isEdgeBlockedAnalytic(AVertex* a, AVertex* b, FVector locationA, FVector locationB, float agentSize) const
+{
+	//Same offsets as the box trace, such that the surface that the vertices are on is not hit
+	float offset = agentSize - 4;
+	FVector sweepStart = locationA + getSurfaceOffset(a->surface, offset);
+	FVector sweepEnd = locationB + getSurfaceOffset(b->surface, offset);
+
+	//Check whether a wall (or obstacle) is hit by a box with the size of the mobile agent
+	if (collisionBVH->sweepBox(sweepStart, sweepEnd, FVector(agentSize), obstaclesBlockEdges)) { return true; }
+
+	//Find the vertices whose cube could be hit by the segment from a to b
+	FBox segmentBox(ForceInit);
+	segmentBox += locationA;
+	segmentBox += locationB;
+	TArray<TPair<AVertex*, FVector>> nearbyVertices;
+	vertexTree->findLocationsInBox(segmentBox.GetCenter(), segmentBox.GetExtent() + FVector(VERTEX_HALF_SIZE), nearbyVertices);
+
+	//The first vertex hit from a has to be b
+	AVertex* firstHit = nullptr;
+	float firstTime = MAX_flt;
+	for (const TPair<AVertex*, FVector>& nearby : nearbyVertices) {
+		if (nearby.Key == a) { continue; }
+		float time;
+		if (FCollisionBVH::intersectSegment(locationA, locationB, FBox::BuildAABB(nearby.Value, FVector(VERTEX_HALF_SIZE)), time) && time < firstTime) {
+			firstHit = nearby.Key;
+			firstTime = time;
+		}
+	}
+
+	return firstHit != b;
+}
+
+void APRM::traceEdgeBlocked(FVector traceStartBase, FVector traceEndBase, ESurfaceType surfaceA, ESurfaceType surfaceB, float agentSize, FHitResult& roomHit, TArray<FHitResult>& vertexHits) const
+{
+	//Add an offset to the start and end points such that the surface that the vertices are on are not used in computing whether there is a blocked edge
+	float offset = agentSize - 4;
+	FVector traceStart = traceStartBase + getSurfaceOffset(surfaceA, offset);
+	FVector traceEnd = traceEndBase + getSurfaceOffset(surfaceB, offset);
+
+	//Same parameters as the Kismet traces that were used before: a simple box trace and a complex line trace
+	FCollisionQueryParams boxParams(FName(TEXT("EdgeTrace")), false, this);
+	boxParams.bReturnPhysicalMaterial = true;
+	FCollisionQueryParams lineParams(FName(TEXT("EdgeTrace")), true, this);
+	lineParams.bReturnPhysicalMaterial = true;
 
 	//Do a box trace from a to b with the size of the mobile agent
-	UKismetSystemLibrary::BoxTraceSingleByProfile(GetWorld(), traceStart, traceEnd, FVector(agentSize), FRotator(0), "EdgeTraceBlocker", false, ignores, EDrawDebugTrace::None, roomHit, true, FLinearColor::Blue, FLinearColor::Green, 60);
-	UKismetSystemLibrary::LineTraceMultiForObjects(GetWorld(), traceStartBase, traceEndBase, traceObjectTypesLine, true, ignores, EDrawDebugTrace::None, vertexHits, true, FLinearColor::Yellow, FLinearColor::Red, 60);
+	GetWorld()->SweepSingleByProfile(roomHit, traceStart, traceEnd, FQuat::Identity, FName(TEXT("EdgeTraceBlocker")), FCollisionShape::MakeBox(FVector(agentSize)), boxParams);
+	GetWorld()->LineTraceMultiByObjectType(vertexHits, traceStartBase, traceEndBase, FCollisionObjectQueryParams(ECollisionChannel::ECC_WorldStatic), lineParams);
+}
 
+bool APRM::isBlockedByHits(const FHitResult& roomHit, const TArray<FHitResult>& vertexHits, AVertex* b)
+{
 	//Check whether a room has been hit
 	if (IsValid(roomHit.GetActor())) {
 		if (roomHit.GetActor()->GetClass() == ABasicRoom::StaticClass()) { return true; }
 	}
 
 	//Check whether a vertex has been hit
-	for (FHitResult hit : vertexHits) {
+	for (const FHitResult& hit : vertexHits) {
 		//Check that there is a hit with an actor
 		if (IsValid(hit.GetActor()))
 		{
@@ -779,6 +1075,21 @@ bool APRM::isEdgeBlocked(AVertex* a, AVertex* b, float agentSize) {
 	return true;
 }
 
+FVector APRM::getSurfaceOffset(ESurfaceType surface, float offset)
+{
+	switch (surface) {
+	case ESurfaceType::Floor: return FVector(0, 0, offset);
+	case ESurfaceType::Ceiling: return FVector(0, 0, -offset);
+	case ESurfaceType::NorthWall: return FVector(-offset, 0, 0);
+	case ESurfaceType::SouthWall: return FVector(offset, 0, 0);
+	case ESurfaceType::EastWall: return FVector(0, -offset, 0);
+	case ESurfaceType::WestWall: return FVector(0, offset, 0);
+	case ESurfaceType::Stairs: return FVector(0, 0, offset);
+	case ESurfaceType::StairsCeiling: return FVector(0, 0, -offset);
+	default: return FVector(0);
+	}
+}
+
 bool APRM::isFutureEdgeBlocked(FVector a, FVector b, ESurfaceType surfaceA, ESurfaceType surfaceB, float agentSize)
 {//Start and end of the trace
 	FVector traceStart = a;
@@ -1098,30 +1409,54 @@ bool APRM::isEdgeDoubleBlockedHelper(AVertex* a, AVertex* b, float agentSize) {
 bool APRM::doesEdgeExist(AVertex* a, AVertex* b)
 {
 	if (a == nullptr || b == nullptr) { return true; }
+
+	//Edges of this PRM are in the edge index. Edges made by other PRMs are only known to the vertices
+	if (edgeIndex.Contains(APRMEdge::getKey(a->id, b->id))) { return true; }
 	return a->neighbours.Contains(b->id);
 }
 
+void APRM::addEdge(APRMEdge* edge)
+{
+	if (edge == nullptr) { return; }
+	edges.AddUnique(edge);
+	edgeIndex.Add(edge->getKey(), edge);
+}
+
+void APRM::rebuildEdgeIndex()
+{
+	edgeIndex.Empty(edges.Num());
+	for (APRMEdge* edge : edges) { if (edge) { edgeIndex.Add(edge->getKey(), edge); } }
+}
+
 bool APRM::isEdgeOverVoid(FVector traceStart, FVector traceEnd) {
 	//Surfaces hit by the trace
 	TArray<FHitResult> hitsAB;
 	TArray<FHitResult> hitsBA;
-	
-	//Actors to ignore
-	TArray<AActor*> ignores;
 
-	//Object types to trace
-	TArray<TEnumAsByte<EObjectTypeQuery>> traceObjectTypesLine;
-	traceObjectTypesLine.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldStatic));
+	//Do the line trace in two directions
+	traceEdgeOverVoid(traceStart, traceEnd, hitsAB, hitsBA);
+
+	return isOverVoidByHits(hitsAB, hitsBA);
+}
+
+void APRM::traceEdgeOverVoid(FVector traceStart, FVector traceEnd, TArray<FHitResult>& hitsAB, TArray<FHitResult>& hitsBA) const
+{
+	FCollisionQueryParams lineParams(FName(TEXT("EdgeTrace")), true, this);
+	lineParams.bReturnPhysicalMaterial = true;
+	FCollisionObjectQueryParams objectParams(ECollisionChannel::ECC_WorldStatic);
 
 	//Do the line trace in two directions
-	UKismetSystemLibrary::LineTraceMultiForObjects(GetWorld(), traceStart, traceEnd, traceObjectTypesLine, true, ignores, EDrawDebugTrace::None, hitsAB, true, FLinearColor::Yellow, FLinearColor::Red, 60);
-	UKismetSystemLibrary::LineTraceMultiForObjects(GetWorld(), traceEnd, traceStart, traceObjectTypesLine, true, ignores, EDrawDebugTrace::None, hitsBA, true, FLinearColor::Red, FLinearColor::Yellow, 60);
+	GetWorld()->LineTraceMultiByObjectType(hitsAB, traceStart, traceEnd, objectParams, lineParams);
+	GetWorld()->LineTraceMultiByObjectType(hitsBA, traceEnd, traceStart, objectParams, lineParams);
+}
 
+bool APRM::isOverVoidByHits(const TArray<FHitResult>& hitsAB, const TArray<FHitResult>& hitsBA)
+{
 	TArray<FHitResult> surfaceHitsAB;
 	TArray<FHitResult> surfaceHitsBA;
 
 	//Make sure to find all hits that belong to surfaces, excluding connection cube hits
-	for (FHitResult hit : hitsAB) { 
+	for (const FHitResult& hit : hitsAB) { 
 		if (hit.GetActor()->GetClass() == ASurfaceArea::StaticClass()) {
 			ASurfaceArea* hitSurface = (ASurfaceArea*) hit.GetActor();
 
@@ -1134,7 +1469,7 @@ bool APRM::isEdgeOverVoid(FVector traceStart, FVector traceEnd) {
 		} 
 	}
 
-	for (FHitResult hit : hitsBA) { 
+	for (const FHitResult& hit : hitsBA) { 
 		if (hit.GetActor()->GetClass() == ASurfaceArea::StaticClass()) {
 			ASurfaceArea* hitSurface = (ASurfaceArea*)hit.GetActor();
 
@@ -1190,7 +1525,8 @@ APRMEdge* APRM::generateEdge(AVertex* a, AVertex* b, int32 ID, ESurfaceType surf
 		b->neighbours.AddUnique(a->id);
 
 		//Add the edge to the array for this PRM
-		edges.AddUnique(newEdge);
+		newEdge->prm = this;
+		addEdge(newEdge);
 
 		return newEdge;
 	}
@@ -1199,6 +1535,37 @@ APRMEdge* APRM::generateEdge(AVertex* a, AVertex* b, int32 ID, ESurfaceType surf
 	return nullptr;
 }
 
+int32 APRM::generateLazyEdges(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 maxEdges, bool samePRMOnly, TArray<AVertex*> &otherNeighbours)
+{
+	int32 edgesGenerated = 0;
+
+	for (AVertex* neighbour : neighbours) {
+		//Neighbours in other PRMs are left for the regular checks
+		if (samePRMOnly && !vertexSet.Contains(neighbour)) {
+			otherNeighbours.Add(neighbour);
+			continue;
+		}
+
+		if (edgesGenerated >= maxEdges) { continue; }
+
+		//Plan the edge without checking it
+		plannedEdges.Add(FPlannedEdge(baseVertex, neighbour, false, true, true));
+		edgesGenerated++;
+	}
+
+	return edgesGenerated;
+}
+
+bool APRM::checkLazyEdge(AVertex* a, AVertex* b, float agentSize)
+{
+	if (a == nullptr || b == nullptr) { return false; }
+
+	//Same checks as when the edge would have been generated directly
+	FEdgeCandidate candidate = FEdgeCandidate(a, b);
+	traceEdgeCandidate(candidate, agentSize);
+	return candidate.isValid();
+}
+
 bool APRM::isNeighbour(int32 neighbourID) {
 	for (FPRMNeighbour neighbour : neighbours) {
 		if (neighbour.neighbourID == neighbourID) {
@@ -1243,3 +1610,39 @@ FPRMConnection::FPRMConnection(AVertex * inVertexA, AVertex* inVertexB)
 	vertexA = inVertexA;
 	vertexB = inVertexB;
 }
+
+void FPRMConnectionSet::reset()
+{
+	connections.Empty();
+	keys.Empty();
+	adjacency.Empty();
+}
+
+bool FPRMConnectionSet::add(AVertex* a, AVertex* b)
+{
+	//Only add the connection if neither (a, b) nor (b, a) exists yet
+	bool alreadyInSet = false;
+	keys.Add(getKey(a, b), &alreadyInSet);
+	if (alreadyInSet) { return false; }
+
+	connections.Add(FPRMConnection(a, b));
+	adjacency.FindOrAdd(a).Add(b);
+	adjacency.FindOrAdd(b).Add(a);
+	return true;
+}
+
+int32 FPRMConnectionSet::degree(AVertex* vertex) const
+{
+	const TArray<AVertex*>* connected = adjacency.Find(vertex);
+	return connected ? connected->Num() : 0;
+}
+
+bool FPRMConnectionSet::contains(AVertex* a, AVertex* b) const
+{
+	return keys.Contains(getKey(a, b));
+}
+
+TPair<AVertex*, AVertex*> FPRMConnectionSet::getKey(AVertex* a, AVertex* b)
+{
+	return a < b ? TPair<AVertex*, AVertex*>(a, b) : TPair<AVertex*, AVertex*>(b, a);
+}
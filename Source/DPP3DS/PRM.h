@@ -7,6 +7,10 @@
 #include "SurfaceArea.h"
 #include "PRMEdge.h"
 #include "HelperVertex.h"
+#include "VertexTree.h"
+#include "CollisionBVH.h"
+#include "BuildRandom.h"
+#include "UnionFind.h"
 #include "PRM.generated.h"
 
 //Structure for indicating that two vertices in two different PRMS should be connected
@@ -33,6 +37,102 @@ public:
 	}
 };
 
+//Set of vertex pairs in different PRMS that should be connected. The order of the two vertices does not matter for lookups, but the connections keep the order they were added in
+class FPRMConnectionSet {
+public:
+	//Removes all connections
+	void reset();
+
+	//Adds a connection from a to b if there is no connection between them yet. Returns true if the connection was added
+	bool add(AVertex* a, AVertex* b);
+
+	//Checks if there is a connection between a and b
+	bool contains(AVertex* a, AVertex* b) const;
+
+	//Checks if the vertex is part of any connection
+	bool isConnected(AVertex* vertex) const { return adjacency.Contains(vertex); }
+
+	//Amount of connections the vertex is part of
+	int32 degree(AVertex* vertex) const;
+
+	//Vertices that the given vertex should be connected to, or nullptr if there are none
+	const TArray<AVertex*>* getConnected(AVertex* vertex) const { return adjacency.Find(vertex); }
+
+	//Amount of connections
+	int32 num() const { return connections.Num(); }
+
+	//Connection with the given index, in the order they were added
+	const FPRMConnection& get(int32 index) const { return connections[index]; }
+
+	//Iterates over the connections in the order they were added
+	TArray<FPRMConnection>::RangedForConstIteratorType begin() const { return connections.begin(); }
+	TArray<FPRMConnection>::RangedForConstIteratorType end() const { return connections.end(); }
+
+private:
+	//Key of a vertex pair that is the same for (a, b) and (b, a)
+	static TPair<AVertex*, AVertex*> getKey(AVertex* a, AVertex* b);
+
+	//The connections in the order they were added
+	TArray<FPRMConnection> connections;
+
+	//Keys of all connections, for finding duplicates
+	TSet<TPair<AVertex*, AVertex*>> keys;
+
+	//For each vertex, the vertices it should be connected to
+	TMap<AVertex*, TArray<AVertex*>> adjacency;
+};
+
+//Candidate edge from a to b with the results of the traces that check if the edge is valid
+struct FEdgeCandidate {
+	FEdgeCandidate(AVertex* inA, AVertex* inB);
+
+	//Vertex the edge starts at
+	AVertex* a;
+
+	//Vertex the edge ends at
+	AVertex* b;
+
+	//Locations of the vertices, read before tracing
+	FVector locationA;
+	FVector locationB;
+
+	//Whether the edge is blocked by a room or another vertex
+	bool blocked;
+
+	//Whether the edge goes over a hole. Only traced if the edge is not blocked
+	bool overVoid;
+
+	//Whether blocked was found without the physics scene, so there are no hits to check
+	bool analytic;
+
+	//Hits of the traces. They are checked on the game thread after tracing, since reading the hit actors is not safe on worker threads
+	FHitResult roomHit;
+	TArray<FHitResult> vertexHits;
+	TArray<FHitResult> hitsAB;
+	TArray<FHitResult> hitsBA;
+
+	//Whether the edge can be generated
+	bool isValid() const { return !blocked && !overVoid; }
+};
+
+//Edge or inter-PRM connection found while planning the edges of a PRM. These are created afterwards on the game thread, in the order they were planned
+struct FPlannedEdge {
+	FPlannedEdge(AVertex* inA, AVertex* inB, bool inConnection, bool inCheckExists, bool inUnchecked);
+
+	//Vertices of the edge or connection
+	AVertex* a;
+	AVertex* b;
+
+	//Whether a and b should be connected later on instead of getting an edge now
+	bool connection;
+
+	//Whether the edge is skipped if it exists by the time it is created
+	bool checkExists;
+
+	//Whether the edge was planned without checking it (lazy PRM)
+	bool unchecked;
+};
+
 UCLASS()
 class DPP3DS_API APRM : public AActor
 {
@@ -80,6 +180,9 @@ public:
 	UPROPERTY(EditAnywhere, Category = "PRM")
 		TArray<APRMEdge*> edges;
 
+	//Mapping from the key of a vertex pair to the edge between them, for the edges of this PRM
+	TMap<uint64, APRMEdge*> edgeIndex;
+
 	//Total size of all surfaces combined
 	UPROPERTY(VisibleAnywhere, Category = "PRM")
 		float totalSize;
@@ -88,6 +191,68 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
 		float coverSize;
 
+	//Spatial index over all vertices, shared by the collector. Used to find nearby vertices without the physics scene
+	FVertexTree* vertexTree;
+
+	//Hierarchy over the walls and obstacles, shared by the collector. If set, blocked edges are found without the physics scene
+	FCollisionBVH* collisionBVH;
+
+	//Random stream of this PRM, seeded by the collector from the build seed
+	FBuildRandom random;
+
+	//Table to draw a surface by its weight. Built by calculateWeights
+	FAliasTable surfaceTable;
+
+	//If true, obstacles block edges in the same way as room walls. Only used with the collision hierarchy
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		bool obstaclesBlockEdges;
+
+	//If true, edges within this PRM are generated without checking if they are blocked. They are checked once an agent plans a path over them
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		bool lazyEdges;
+
+	//If true, the traces of the candidate edges of a vertex are done in parallel before the edges are generated
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		bool parallelEdgeTraces;
+
+	//If true, random vertices are placed with Poisson-disk sampling, so no two vertices are closer than the agent size
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		bool poissonDisk;
+
+	//Part of the random vertices placed near narrow passages and transitions to other surfaces instead of uniformly. 0 turns this off
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		float narrowPassageShare;
+
+	//Amount of vertices placed near narrow passages and transitions
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 biasedVertices;
+
+	//If true, a candidate edge is only traced if it joins two parts of this PRM that are not connected yet
+	UPROPERTY(EditAnywhere, Category = "PRM")
+		bool componentEdges;
+
+	//Parts of this PRM that are connected by edges, by index of the vertex in componentIndices. Only kept with componentEdges
+	FUnionFind components;
+	TMap<int32, int32> componentIndices;
+
+	//Vertices of this PRM while the edges are planned, so checking if a neighbour is in this PRM does not depend on the amount of vertices. Only kept with lazyEdges
+	TSet<AVertex*> vertexSet;
+
+	//Time it took to generate the edges of this PRM
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan edgeTime;
+
+	//Amount of candidate edges that were traced while generating the edges of this PRM
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 tracedCandidates;
+
+	//Amount of candidate edges that were not traced because both vertices were already connected. Only counted with componentEdges
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 skippedCandidates;
+
+	//Edges and connections found by planEdges that have not been created yet
+	TArray<FPlannedEdge> plannedEdges;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -112,9 +277,8 @@ public:
 	UFUNCTION(CallInEditor, Category = "Rendering")
 		void showPRM();
 
-	//Calculate the size of the cover
-	UFUNCTION(CallInEditor, Category = "PRM")
-		float calculateCoverSize(float agentSize);
+	//Calculate the size of the cover from the edges of every surface type
+	float calculateCoverSize(float agentSize, float cellSize, const TMap<ESurfaceType, TArray<APRMEdge*>>& typeEdges);
 
 	//Sets the vertex count depending on the total size and the vertex density of the collector
 	void setVertexCount(float inverseVertexDensity);
@@ -122,6 +286,15 @@ public:
 	// Generate random vertices on the surfaces. Returns the ID of the last generated vertex + 1
 	int32 generateRandomVertices(int32 startID, float agentSize, bool apsmo, bool assmo);
 
+	// Generate about count vertices spread over the surfaces by weight, at least agentSize apart. Returns the ID of the last generated vertex + 1
+	int32 generatePoissonVertices(int32 startID, float agentSize, int32 count);
+
+	// Generate about count random vertices spread by weight over the surfaces that are still active. Returns the ID of the last generated vertex + 1
+	int32 generateAdaptiveVertices(int32 startID, float agentSize, int32 count, const TSet<ASurfaceArea*>& activeSurfaces);
+
+	// Adds the footprint of the edges from firstEdge on to the coverage of the surfaces they lie on
+	void addEdgeCoverage(int32 firstEdge, float agentSize);
+
 	// Generate vertices approximately on the medial axis of the surfaces. Returns the ID of the last generated vertex + 1
 	int32 generateApproximateMedialVertices(int32 startID, float agentSize);
 
@@ -146,6 +319,9 @@ public:
 	// Generate a single vertex
 	int32 generateVertex(int32 startID, ASurfaceArea* surface, float agentSize);
 
+	// Generate a single vertex near a narrow passage or a transition to another surface. Falls back to a regular vertex if no such vertex is found
+	int32 generateBiasedVertex(int32 startID, ASurfaceArea* surface, float agentSize);
+
 	// Generate a single vertex at the given location
 	int32 generateVertexAtLocation(int32 startID, ASurfaceArea* surface, FVector location, float agentSize);
 
@@ -153,14 +329,58 @@ public:
 	int32 generateVertexInSubsurface(int32 startID, ASurfaceArea* surface, int32 index, float agentSize);
 
 	// Generate edges between vertices. Returns the ID of the last generated edge + 1
-	int32 generateEdges(int32 startID, float agentSize, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, bool knn, bool knn3d);
+	int32 generateEdges(int32 startID, float agentSize, FPRMConnectionSet& connections, bool knn, bool knn3d);
+
+	// Finds the edges of the vertices from firstVertex on without creating them. Checks the hits of the traces, so it has to run on the game thread
+	void planEdges(float agentSize, bool knn, bool knn3d, int32 firstVertex);
 
-	// Find neighbouring vertices in a specific range
-	TArray<AVertex*> findAllNearbyNeighbours(AVertex* baseVertex, FVector extent, TArray<AVertex*> checkedVertices);
+	// Creates the planned edges and adds the planned connections. Has to run on the game thread. Returns the ID of the last generated edge + 1
+	int32 commitEdges(int32 startID, FPRMConnectionSet& connections);
+
+	// Find neighbouring vertices in a specific range, optionally sorted so that the nearest neighbour is first
+	TArray<AVertex*> findAllNearbyNeighbours(AVertex* baseVertex, FVector extent, const TSet<AVertex*>& checkedVertices, bool sortByDistance);
 
 	// Check if the edge from a to b is blocked. Returns true if so or if no collision happens
 	bool isEdgeBlocked(AVertex* a, AVertex* b, float agentSize);
 
+	// Traces the candidate edges from baseVertex to count neighbours starting at first, in parallel if parallelEdgeTraces is set. The candidates are returned in the order of the neighbours
+	TArray<FEdgeCandidate> traceEdgeCandidates(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 first, int32 count, float agentSize);
+
+	// Traces and checks a single candidate edge on the game thread
+	void traceEdgeCandidate(FEdgeCandidate& candidate, float agentSize) const;
+
+	// Traces whether a candidate edge is blocked and stores the hits. Only queries the physics scene, so it can be called from worker threads
+	void traceCandidateBlocked(FEdgeCandidate& candidate, float agentSize) const;
+
+	// Traces whether a candidate edge that is not blocked goes over a hole and stores the hits. Only queries the physics scene, so it can be called from worker threads
+	void traceCandidateOverVoid(FEdgeCandidate& candidate) const;
+
+	// Checks the stored hits of a candidate edge. Reads the hit actors, so this has to be called on the game thread
+	static void checkCandidateBlocked(FEdgeCandidate& candidate);
+	static void checkCandidateOverVoid(FEdgeCandidate& candidate);
+
+	// Plans up to maxEdges edges from baseVertex, only tracing the nearest neighbour of each part of this PRM it is not connected to yet.
+	// Neighbours in other PRMS are traced as usual and, if connectOthers is set, planned as a connection if the trace fails. Returns the amount of planned edges and connections
+	int32 planComponentEdges(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 maxEdges, bool connectOthers, float agentSize);
+
+	// Checks if an edge is blocked using the collision hierarchy and the spatial index of the vertices instead of the physics scene
+	bool isEdgeBlockedAnalytic(AVertex* a, AVertex* b, FVector locationA, FVector locationB, float agentSize) const;
+
+	// Does the box and line traces used to check if an edge is blocked
+	void traceEdgeBlocked(FVector traceStartBase, FVector traceEndBase, ESurfaceType surfaceA, ESurfaceType surfaceB, float agentSize, FHitResult& roomHit, TArray<FHitResult>& vertexHits) const;
+
+	// Checks the hits of traceEdgeBlocked. Returns true if a room is hit or if the first vertex hit is not b
+	static bool isBlockedByHits(const FHitResult& roomHit, const TArray<FHitResult>& vertexHits, AVertex* b);
+
+	// Does the line traces in both directions used to check if an edge is over a hole
+	void traceEdgeOverVoid(FVector traceStart, FVector traceEnd, TArray<FHitResult>& hitsAB, TArray<FHitResult>& hitsBA) const;
+
+	// Checks the hits of traceEdgeOverVoid. Returns true if the surface hits in both directions do not match
+	static bool isOverVoidByHits(const TArray<FHitResult>& hitsAB, const TArray<FHitResult>& hitsBA);
+
+	// Finds the offset from a surface of the given type, such that a trace does not hit the surface itself
+	static FVector getSurfaceOffset(ESurfaceType surface, float offset);
+
 	// Check if the edge from a to b is blocked. Returns true if so or if no collision happens
 	bool isFutureEdgeBlocked(FVector a, FVector b, ESurfaceType surfaceA, ESurfaceType surfaceB, float agentSize);
 
@@ -176,9 +396,21 @@ public:
 	// Check if an edge already exists between vertices a and b
 	bool doesEdgeExist(AVertex* a, AVertex* b);
 
+	// Adds an edge to the edges of this PRM and to the edge index
+	void addEdge(APRMEdge* edge);
+
+	// Rebuilds the edge index from the edges of this PRM
+	void rebuildEdgeIndex();
+
 	// Creates a single edge between vertices a and b
 	APRMEdge* generateEdge(AVertex* a, AVertex* b, int32 ID, ESurfaceType surfaceType, bool showEdge);
 
+	// Plans edges from baseVertex to at most maxEdges neighbours without checking them. With samePRMOnly, neighbours of other PRMs are skipped and returned in otherNeighbours
+	int32 generateLazyEdges(AVertex* baseVertex, const TArray<AVertex*>& neighbours, int32 maxEdges, bool samePRMOnly, TArray<AVertex*> &otherNeighbours);
+
+	// Checks an edge from a to b that was generated without checking it. Returns true if the edge is valid
+	bool checkLazyEdge(AVertex* a, AVertex* b, float agentSize);
+
 	// Checks if an edge from a to b is over a hole, so an area between two surfaces
 	bool isEdgeOverVoid(FVector traceStart, FVector traceEnd);
 
@@ -30,6 +30,12 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
 		float totalArea;
 
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		float coverCellSize;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan coverTime;
+
 	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
 		int32 totalConnections;
 
@@ -41,5 +47,101 @@ public:
 
 	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
 		int32 clFarApart;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan searchTimeBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan searchTimeAfter;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		TArray<FTimespan> edgeTimes;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int64 generateMemory;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int64 connectMemory;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan generateTime;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan candidateTime;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan resolveTime;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan connectTime;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 buildSeed;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool lowDiscrepancySampling;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool poissonDiskSampling;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool adaptiveVertexBudget;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 fixedVertexCount;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 verticesSaved;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool componentAwareEdges;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 skippedCandidates;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 skippedConnections;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool narrowPassageSampling;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 biasedVertices;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 componentCount;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 largestComponent;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 repairAttempts;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 repairedVertices;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		bool spannerPruning;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		float spannerStretch;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 spannerEdgesBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		int32 spannerEdgesAfter;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan queryTimeBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		FTimespan queryTimeAfter;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		float pathLengthBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "PRM Save")
+		float pathLengthAfter;
 	
 };
@@ -6,6 +6,98 @@
 #include "DrawDebugHelpers.h"
 #include "PRM.h"
 #include "BasicRoom.h"
+#include "Obstacle.h"
+#include "Async/ParallelFor.h"
+#include "CostPolicy.h"
+#include "Agent.h"
+#include "PRMGenerator.h"
+
+//Vertex locations and surfaces by ID with an adjacency list, used to find shortest paths without touching the actors
+struct FSpannerGraph
+{
+	TArray<FVector> locations;
+	TArray<ESurfaceType> surfaces;
+
+	//Per ID whether the vertex exists and whether it is a helper vertex
+	TArray<bool> exists;
+	TArray<bool> helpers;
+
+	TArray<TArray<int32>> adjacency;
+
+	//Search state. Only the costs of touched IDs are reset between searches
+	TArray<float> costs;
+	TArray<int32> touched;
+};
+
+//Fills the graph with the vertices. The adjacency is left empty
+static void buildSpannerGraph(const TArray<AVertex*>& vertices, FSpannerGraph& graph)
+{
+	int32 maxID = 0;
+	for (AVertex* vertex : vertices) { if (vertex) { maxID = FMath::Max(maxID, vertex->id); } }
+
+	graph.locations.Init(FVector(0), maxID + 1);
+	graph.surfaces.Init(ESurfaceType::Floor, maxID + 1);
+	graph.exists.Init(false, maxID + 1);
+	graph.helpers.Init(false, maxID + 1);
+	graph.adjacency.Reset();
+	graph.adjacency.SetNum(maxID + 1);
+	graph.costs.Init(MAX_flt, maxID + 1);
+	graph.touched.Reset();
+
+	for (AVertex* vertex : vertices) {
+		if (!vertex || vertex->id < 0) { continue; }
+		graph.locations[vertex->id] = vertex->GetActorLocation();
+		graph.surfaces[vertex->id] = vertex->surface;
+		graph.exists[vertex->id] = true;
+		graph.helpers[vertex->id] = Cast<AHelperVertex>(vertex) != nullptr;
+	}
+}
+
+//Finds the cost of the cheapest path from start to goal for an agent with the given cost policy. Stops at bound and returns MAX_flt if there is no path within it
+template<typename TPolicy>
+static float findBoundedCost(const TPolicy& policy, FSpannerGraph& graph, int32 start, int32 goal, float bound)
+{
+	for (int32 id : graph.touched) { graph.costs[id] = MAX_flt; }
+	graph.touched.Reset();
+
+	auto cheapestFirst = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; };
+	TArray<TPair<float, int32>> open;
+	graph.costs[start] = 0;
+	graph.touched.Add(start);
+	open.HeapPush(TPair<float, int32>(0, start), cheapestFirst);
+
+	while (open.Num() > 0) {
+		TPair<float, int32> current;
+		open.HeapPop(current, cheapestFirst, false);
+		if (current.Key > graph.costs[current.Value]) { continue; }
+		if (current.Value == goal) { return current.Key; }
+
+		for (int32 neighbourID : graph.adjacency[current.Value]) {
+			if (!graph.exists.IsValidIndex(neighbourID) || !graph.exists[neighbourID] || !policy.canTraverse(graph.surfaces[neighbourID])) { continue; }
+
+			float cost = current.Key + FVector::Dist(graph.locations[current.Value], graph.locations[neighbourID]) + policy.getPenalty(graph.surfaces[current.Value], graph.surfaces[neighbourID]);
+			if (cost > bound || cost >= graph.costs[neighbourID]) { continue; }
+
+			if (graph.costs[neighbourID] == MAX_flt) { graph.touched.Add(neighbourID); }
+			graph.costs[neighbourID] = cost;
+			open.HeapPush(TPair<float, int32>(cost, neighbourID), cheapestFirst);
+		}
+	}
+
+	return MAX_flt;
+}
+
+//Checks if an agent with the given cost policy needs the edge from a to b, which is the case if the graph has no path within stretch times the cost of the edge in either direction
+template<typename TPolicy>
+static bool isEdgeNeeded(const TPolicy& policy, FSpannerGraph& graph, int32 a, int32 b, float stretch)
+{
+	if (!policy.canTraverse(graph.surfaces[a]) || !policy.canTraverse(graph.surfaces[b])) { return false; }
+
+	float length = FVector::Dist(graph.locations[a], graph.locations[b]);
+	float forwardBound = stretch * (length + policy.getPenalty(graph.surfaces[a], graph.surfaces[b]));
+	float backwardBound = stretch * (length + policy.getPenalty(graph.surfaces[b], graph.surfaces[a]));
+	return findBoundedCost(policy, graph, a, b, forwardBound) > forwardBound || findBoundedCost(policy, graph, b, a, backwardBound) > backwardBound;
+}
 
 // Sets default values
 APRMCollector::APRMCollector()
@@ -13,6 +105,45 @@ APRMCollector::APRMCollector()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
+	//Default amount of searches for measuring the search time
+	searchBenchmarkCount = 100;
+	parallelEdgeTraces = true;
+	analyticCollision = false;
+	vertexTombstones = 0;
+	edgeIndexValid = false;
+	lazyEdges = false;
+	parallelPRMs = false;
+	parallelConnections = true;
+	buildSeed = 0;
+	lowDiscrepancySampling = false;
+	poissonDiskSampling = false;
+	freeSpaceSampling = false;
+	freeRectangles = 0;
+	adaptiveVertexBudget = false;
+	coverageTarget = 0.9f;
+	coverCellSize = 5;
+	spannerPruning = false;
+	spannerStretch = 1.5f;
+	componentAwareEdges = false;
+	skippedConnections = 0;
+	narrowPassageSampling = false;
+	narrowPassageShare = 0.3f;
+	repairAllSurfaces = false;
+	minimumConnectionDegree = 1;
+	repairAttempts = 0;
+	repairedVertices = 0;
+	spannerEdgesBefore = 0;
+	spannerEdgesAfter = 0;
+	pathLengthBefore = 0;
+	pathLengthAfter = 0;
+	fixedVertexCount = 0;
+	verticesSaved = 0;
+	componentCount = 0;
+	largestComponent = 0;
+	lazyChecks = 0;
+	lazyRemovals = 0;
+	generateMemory = 0;
+	connectMemory = 0;
 }
 
 // Called when the game starts or when spawned
@@ -36,6 +167,7 @@ void APRMCollector::collectPRMS() {
 	//Prepare all the surfaces
 	connectivityGraph->CollectSurfaces();
 	connectivityGraph->ConnectSurfaces();
+	buildConnectionFrames();
 
 	//Start with an empty PRM array
 	PRMS.Empty();
@@ -72,12 +204,28 @@ void APRMCollector::collectPRMS() {
 	}
 
 	//Reset the inter prm connections
-	interPRMConnections = {};
+	interPRMConnections.reset();
 }
 
 void APRMCollector::generatePRMS() {
+	int64 startMemory = getUsedMemory();
+	FDateTime phaseStart = FDateTime::Now();
 	startVertexID = 0;
 	startEdgeID = 0;
+	repairAttempts = 0;
+	repairedVertices = 0;
+
+	//New vertices are inserted into the spatial index as they are generated
+	rebuildVertexTree();
+	buildCollisionBVH();
+	seedRandomStreams();
+	buildFreeSpace();
+	for (APRM* PRM : PRMS) { PRM->parallelEdgeTraces = parallelEdgeTraces; PRM->lazyEdges = lazyEdges; PRM->poissonDisk = poissonDiskSampling; PRM->componentEdges = componentAwareEdges; }
+	for (AProjectionCuboid* cuboid : projectionCuboids) { if (cuboid) { cuboid->poissonDisk = poissonDiskSampling; } }
+	for (APRM* PRM : PRMS) {
+		PRM->narrowPassageShare = narrowPassageSampling ? narrowPassageShare : 0;
+		PRM->biasedVertices = 0;
+	}
 
 	//Depending on which PRM method is used, generate a PRM
 	if (useMedialAxis) {
@@ -94,7 +242,7 @@ void APRMCollector::generatePRMS() {
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AVertex::StaticClass(), temp);
 	for (AActor* actor : temp) { 
 		AVertex* newVertex = (AVertex*)actor; 
-		if (newVertex != nullptr) { vertices.AddUnique(newVertex); }
+		if (newVertex != nullptr) { addVertex(newVertex); }
 	}
 
 	//Add all created edges into an array
@@ -102,8 +250,12 @@ void APRMCollector::generatePRMS() {
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), APRMEdge::StaticClass(), temp);
 	for (AActor* actor : temp) {
 		APRMEdge* newEdge = (APRMEdge*)actor;
-		if (newEdge != nullptr) { edges.AddUnique(newEdge); }
+		if (newEdge != nullptr) { addEdge(newEdge); }
 	}
+
+	generateMemory = getUsedMemory() - startMemory;
+	generateTime = FDateTime::Now() - phaseStart;
+	saveEdgeTimes();
 }
 
 void APRMCollector::setNeighboursPRMS()
@@ -166,367 +318,151 @@ void APRMCollector::connectPRMS()
 	int32 notNearby = 0;
 	int32 nearbyNotConnected = 0;
 	madeConnections = 0; TArray<TSet<APRM*>> prmConnections;
+	int64 startMemory = getUsedMemory();
+	FDateTime phaseStart = FDateTime::Now();
+
+	//The connection frames are not saved with the level
+	if (connectionFrames.Num() < 1) { buildConnectionFrames(); }
 
 	//If there are no interPRMConnections yet, find them. This is used in all cases exact KNN3D
-	if (interPRMConnections.Num() < 1){
+	if (interPRMConnections.num() < 1){
 		//Put all PRMS in a separate array to ensure they can be removed from an array
 		//TArray<APRM*> tempPRMS;
 		//for (APRM* PRM : PRMS) { tempPRMS.AddUnique(PRM); }
 		//UE_LOG(LogTemp, Log, TEXT("There are no connections yet"));
 
-		//Go over every PRM in a way that each neighbouring pair is only handled once
-		for (APRM* a : PRMS) {
-			//Keeps track of the IDs of the PRMS that were connected to already.
-			TArray<int32> connectedIDS;
-
-			for (FPRMNeighbour neighbourStruct : a->neighbours) {
-				bool addedEdge = false;
-				if (neighbourStruct.neighbourID > 0 && neighbourStruct.neighbourID < PRMS.Num()) {
-					//Find the PRM related to this neighbour
-					APRM* b = PRMS[neighbourStruct.neighbourID];
-
-					//Find the surfaces of A and B that are used in this neighbour connection
-					ASurfaceArea* surfaceA = a->getSurfaceFromStruct(neighbourStruct);
-					ASurfaceArea* surfaceB = a->getNeighbourSurfaceFromStruct(b, neighbourStruct);
-
-					//Make sure surfaceB exists! If not, something went wrong with the surface connections!
-					if (!surfaceB) { UE_LOG(LogTemp, Log, TEXT("No surfaceB found! a: %s; Surface A: %s; id: %d; b: %s"), *a->GetName(), *surfaceA->GetName(), surfaceA->id, *b->GetName()); return; }
-
-					//Find the surface structs and ensure that the cubes exist
-					FSurfaceNeighbour surfaceStructA = surfaceA->getNeighbourFromID(surfaceB->id);
-					if (surfaceStructA.cube == nullptr) {
-						UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s to %s"), *surfaceA->GetName(), *surfaceB->GetName());
-						return;
-					}
-					FSurfaceNeighbour surfaceStructB = surfaceB->getNeighbourFromID(surfaceA->id);
-					if (surfaceStructB.cube == nullptr) {
-						UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s from %s"), *surfaceB->GetName(), *surfaceA->GetName());
-						return;
-					}
-
-					///Declare all variables used in the case distinction!
-					//Arrays used for overlap functions
-					TArray<AVertex*> aVertices;
-					TArray<AVertex*> bVertices;
-
-					//Extra vertices in case connections have to be guaranteed
-					//AVertex* extraVertexA = nullptr;
-					//AVertex* extraVertexB = nullptr;
-
-					//For defining the nearby areas and overlapping area
-					FVector overlapCenter = FVector(0);
-					FVector overlapExtentBox = FVector(0);
-					FVector aCenter = FVector(0);
-					FVector aExtentBox = FVector(0);
-					FVector bCenter = FVector(0);
-					FVector bExtentBox = FVector(0);
-
-					//For the extents of the surface cube and the overlap area
-					FVector overlapTNE = surfaceStructA.tne;
-					FVector overlapBSW = surfaceStructA.bsw;
-					FVector aTNE = surfaceStructA.cube->GetComponentLocation() + 50 * surfaceStructA.cube->GetComponentScale();
-					FVector aBSW = surfaceStructA.cube->GetComponentLocation() - 50 * surfaceStructA.cube->GetComponentScale();
-					FVector bTNE = surfaceStructB.cube->GetComponentLocation() + 50 * surfaceStructB.cube->GetComponentScale();
-					FVector bBSW = surfaceStructB.cube->GetComponentLocation() - 50 * surfaceStructB.cube->GetComponentScale();
-
-					//The overlaps are different in case of the stairs
-					if (neighbourStruct.cm == EConnectionMethod::SCB) {
-						if (surfaceStructA.connectionCube == nullptr) {
-							UE_LOG(LogTemp, Log, TEXT("surfaceStructA does not have a connection cube: %s and %s"), *surfaceA->GetName(), *surfaceB->GetName());
-							return;
-						}
-						overlapTNE = surfaceStructA.connectionCube->GetComponentLocation() + 50 * surfaceStructA.connectionCube->GetComponentScale();
-						overlapBSW = surfaceStructA.connectionCube->GetComponentLocation() - 50 * surfaceStructA.connectionCube->GetComponentScale();
-					}
-
-					//Find the nearby areas for a and b (add to the TNE and BSW up to the maximum of the cube)
-					findTNEBSW(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, aTNE, aBSW, bTNE, bBSW);
-					findNearbyAreas(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, overlapCenter, overlapExtentBox, aCenter, aExtentBox, bCenter, bExtentBox);
+		//The candidates are found through the spatial index, which is not saved with the level
+		if (vertexTree.num() != vertices.Num()) { rebuildVertexTree(); }
 
-					//Find all vertices in the nearby areas to (possibly) connect
-
-					findVertices(aCenter, aExtentBox, bCenter, bExtentBox, aVertices, bVertices);
-
-					//Prepare connections between vertex pairs
-					for (AVertex* vertexA : aVertices) {
-						for (AVertex* vertexB : bVertices) {
-							FPRMConnection connection = FPRMConnection(vertexA, vertexB);
-							interPRMConnections.AddUnique(connection);
-						}
-					}
-				}
-			}
+		//Find the candidates of every PRM. This only reads the surfaces and the spatial index, so the PRMS can be handled at the same time
+		TArray<TArray<FPRMConnection>> candidates;
+		candidates.SetNum(PRMS.Num());
+		TArray<bool> foundCandidates;
+		foundCandidates.Init(true, PRMS.Num());
+		ParallelFor(PRMS.Num(), [&](int32 i) { foundCandidates[i] = findConnectionCandidates(PRMS[i], candidates[i]); }, !parallelConnections);
 
-			/*//Prepare the IDs for the vertices and edges
-			int32 newID = vertices.Num();
-			int32 nextNewID = newID;
-			int32 newEdgeID = edges.Num();
-
-			//Normals and projections
-			FVector normalA = FVector(0);
-			FVector normalB = FVector(0);
-			FVector projectionA = FVector(0);
-			FVector projectionB = FVector(0);
-			FVector projectionA2 = FVector(0);
-			FVector projectionB2 = FVector(0);
-
-			//Helper vertices, edges and their locations
-			FVector helperLocationA = FVector(0);
-			FVector helperLocationB = FVector(0);
-			FVector searchExtent = FVector(0);
-			AVertex* newHelperVertexA = nullptr;
-			AVertex* newHelperVertexB = nullptr;
-			APRMEdge* helperEdgeA = nullptr;
-			APRMEdge* helperEdgeB = nullptr;
-			APRMEdge* helperEdgeC = nullptr;
-
-			//For the extents of the surface cube and the overlap area
-			FVector overlapTNE = surfaceStructA.tne;
-			FVector overlapBSW = surfaceStructA.bsw;
-			FVector aTNE = surfaceStructA.cube->GetComponentLocation() + 50 * surfaceStructA.cube->GetComponentScale();
-			FVector aBSW = surfaceStructA.cube->GetComponentLocation() - 50 * surfaceStructA.cube->GetComponentScale();
-			FVector bTNE = surfaceStructB.cube->GetComponentLocation() + 50 * surfaceStructB.cube->GetComponentScale();
-			FVector bBSW = surfaceStructB.cube->GetComponentLocation() - 50 * surfaceStructB.cube->GetComponentScale();
-
-			//The overlaps are different in case of the stairs
-			if (neighbourStruct.cm == EConnectionMethod::SCB) {
-				overlapTNE = surfaceStructA.connectionCube->GetComponentLocation() + 50 * surfaceStructA.connectionCube->GetComponentScale();
-				overlapBSW = surfaceStructA.connectionCube->GetComponentLocation() - 50 * surfaceStructA.connectionCube->GetComponentScale();
-			}
-
-			//Find the nearby areas for a and b (add to the TNE and BSW up to the maximum of the cube)
-			findTNEBSW(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, aTNE, aBSW, bTNE, bBSW);
-			findNearbyAreas(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, overlapCenter, overlapExtentBox, aCenter, aExtentBox, bCenter, bExtentBox);
-
-			//Find all vertices in the nearby areas to (possibly) connect
-			findVertices(aCenter, aExtentBox, bCenter, bExtentBox, aVertices, bVertices);
-
-			//Prepare connections between vertex pairs
-			for (AVertex* vertexA : aVertices) { for (AVertex* vertexB : bVertices) {
-				FPRMConnection connection = FPRMConnection(vertexA, vertexB);
-				interPRMConnections.AddUnique(connection);
-			} }
-
-
-			//If either PRM has no nearby vertices and the guarantee connections option is on, generate an extra vertex in the nearby area
-			/*if (guaranteeNearbyVertices && aVertices.Num() < 1) {
-					int32 oldID = newEdgeID;
-					newEdgeID = generateExtraVertex(extraVertexA, a, surfaceA, surfaceStructA.cube, newID, newEdgeID, aTNE, aBSW, true, aVertices);
+		//Merge the candidates in the order of the PRMS, so the connections are the same as when the PRMS are handled one after the other
+		for (int32 i = 0; i < PRMS.Num(); i++) {
+			for (const FPRMConnection& connection : candidates[i]) { interPRMConnections.add(connection.vertexA, connection.vertexB); }
+			if (!foundCandidates[i]) { return; }
+		}
+	}
 
-					if (oldID != newEdgeID) { notNearby++; }
-				}
+	candidateTime = FDateTime::Now() - phaseStart;
+	phaseStart = FDateTime::Now();
 
-			if (guaranteeNearbyVertices && bVertices.Num() < 1) {
-					int32 oldID = newEdgeID;
-					newEdgeID = generateExtraVertex(extraVertexB, b, surfaceB, surfaceStructB.cube, newID, newEdgeID, bTNE, bBSW, true, bVertices);
-
-					if (oldID != newEdgeID) { notNearby++; }
-				}*/
-			/*
-				//Connect the PRMS based on the connection method
-				switch (neighbourStruct.cm) {
-					//Double Connection Box
-				case EConnectionMethod::DCB:
-					for (AVertex* vertexA : aVertices) {
-						for (AVertex* vertexB : bVertices) {
-							if ((vertexA->GetActorLocation() - vertexB->GetActorLocation()).Size() < 400) {
-								//Find the projection of A onto the surface of B and vice versa, as well as the normals and the orthogonal to the normals
-								FVector orthogonalAB = FVector(0);
-								FVector connectionNormal = FVector(0);
-								findNormalsDCB(neighbourStruct.cm, surfaceA, surfaceB, overlapCenter, overlapExtentBox, vertexA, vertexB, normalA, normalB, orthogonalAB, connectionNormal);
-								projectVerticesDCB(vertexA, vertexB, normalA, normalB, connectionNormal, aExtentBox, bExtentBox, aTNE, aBSW, bTNE, bBSW, projectionA, projectionB);
-
-								//In case the two surfaces are opposites, ensure that the distance between the vertices around the corner is not too big, or that the distance in general is not too big
-								float projectionsDist = (projectionA - vertexA->GetActorLocation()).Size() + (projectionB - vertexB->GetActorLocation()).Size();
-								if (projectionsDist < 800) {
-									//Find the location of the helper vertices
-									findHelperLocations(neighbourStruct.cm, vertexA, vertexB, projectionA, projectionB, normalA, normalB, orthogonalAB, connectionNormal, helperLocationA, helperLocationB);
-
-									//Create the helper vertices
-									if (checkNearSurface(helperLocationA)) { newHelperVertexA = createHelperVertex(surfaceA, helperLocationA, FVector(50), surfaceA->surface, newID, nextNewID, vertexA, vertexB); }
-									newID = nextNewID;
-									if (checkNearSurface(helperLocationB)) { newHelperVertexB = createHelperVertex(surfaceB, helperLocationB, FVector(50), surfaceB->surface, newID, nextNewID, vertexA, vertexB); }
-									newID = nextNewID;
-
-									//Create the edges between the (helper) vertices
-									addedEdge = connectHelperVertices(a, b, vertexA, vertexB, newHelperVertexA, newHelperVertexB, helperEdgeA, helperEdgeB, helperEdgeC, newEdgeID, newEdgeID);
-								}
-							}
-						}
-					}
-					break;
+	//Vertices of every PRM, so finding the PRM of a vertex does not depend on the amount of vertices
+	TArray<TSet<AVertex*>> prmVertices;
+	prmVertices.SetNum(PRMS.Num());
+	for (int32 i = 0; i < PRMS.Num(); i++) { prmVertices[i].Append(PRMS[i]->vertices); }
 
-					//Single Connection Box. Only the stairs case is handled, as the neighbouring case is already handled by the regular PRM connections
-				case EConnectionMethod::SCB:
-					if (surfaceA->surface == ESurfaceType::Stairs || surfaceA->surface == ESurfaceType::StairsCeiling || surfaceB->surface == ESurfaceType::Stairs || surfaceB->surface == ESurfaceType::StairsCeiling) {
-						for (AVertex* vertexA : aVertices) {
-							for (AVertex* vertexB : bVertices) {
-								if ((vertexA->GetActorLocation() - vertexB->GetActorLocation()).Size() < 400) {
-									//Find the projection of A onto the surface of B and vice versa
-									findNormals(neighbourStruct.cm, surfaceA, surfaceB, overlapCenter, vertexA, vertexB, normalA, normalB);
-
-									//Find the normal of the side, which would be the direction from a to b if a is above
-									FVector normalC = findNormalC(normalA, aCenter, bCenter);
-									FVector orthogonalAC = FVector::CrossProduct(normalA, normalC).GetAbs();
-
-									//Project the vertices onto the sides of the surfaces
-									projectVerticesSCB(vertexA, vertexB, normalA, normalB, normalC, aExtentBox, bExtentBox, aTNE, aBSW, bTNE, bBSW, projectionA, projectionB);
-
-									//Find the location for the helper vertices in between the two projections
-									findHelperLocations(neighbourStruct.cm, vertexA, vertexB, projectionA, projectionB, normalA, normalB, normalC, orthogonalAC, helperLocationA, helperLocationB);
-
-									//Find out if the transition is on the floor or the ceiling
-									ESurfaceType transitionType = findStairsTransition(surfaceA->surface, surfaceB->surface);
-
-									//Ensure that connections are only made on stairs, not with any surface!
-									if (transitionType != ESurfaceType::TransitionEdge) {
-										newHelperVertexA = createHelperVertex(surfaceA, helperLocationA, FVector(20), transitionType, newID, nextNewID, vertexA, vertexB);
-										newID = nextNewID;
-										newHelperVertexB = createHelperVertex(surfaceB, helperLocationB, FVector(20), transitionType, newID, nextNewID, vertexA, vertexB);
-										newID = nextNewID;
-
-										//Create the edges between the (helper) vertices
-										addedEdge = connectHelperVertices(a, b, vertexA, vertexB, newHelperVertexA, newHelperVertexB, helperEdgeA, helperEdgeB, helperEdgeC, newEdgeID, newEdgeID);
-									}
-								}
-							}
-						}
-					}
-					break;
+	//For every connection, find the PRM of the first vertex and the neighbours of that PRM that contain the second vertex. This only reads the roadmap, so all connections are handled at the same time
+	TArray<int32> connectionPRMs;
+	TArray<TArray<int32>> neighbourCandidates;
+	TArray<int32> connectionNeighbours;
+	connectionPRMs.Init(INDEX_NONE, interPRMConnections.num());
+	neighbourCandidates.SetNum(interPRMConnections.num());
+	connectionNeighbours.Init(INDEX_NONE, interPRMConnections.num());
+	ParallelFor(interPRMConnections.num(), [&](int32 c) {
+		const FPRMConnection& connection = interPRMConnections.get(c);
 
-					//Direct Connection
-				case EConnectionMethod::Direct:
-					for (AVertex* vertexA : aVertices) {
-						for (AVertex* vertexB : bVertices) {
-							if ((vertexA->GetActorLocation() - vertexB->GetActorLocation()).Size() < 400) {
-								//Find the projection of A onto the surface of B and vice versa
-								findNormals(neighbourStruct.cm, surfaceA, surfaceB, overlapCenter, vertexA, vertexB, normalA, normalB);
-
-								//Find the projections of the vertices onto each other's surfaces
-								findDirectProjection(vertexA, vertexB, normalA, normalB, overlapTNE, overlapBSW, projectionA, projectionB);
-
-								//Find the location of the helper vertex
-								findHelperLocation(vertexA, vertexB, projectionA, projectionB, helperLocationA);
-
-								//There is a direct connection between two vertices, so check for an edge!
-								if (!helperLocationA.ContainsNaN()) {
-									FMath::Clamp(helperLocationA.X, overlapBSW.X, overlapTNE.X);
-									FMath::Clamp(helperLocationA.Y, overlapBSW.Y, overlapTNE.Y);
-									FMath::Clamp(helperLocationA.Z, overlapBSW.Z, overlapTNE.Z);
-									searchExtent = pairwiseMult((FVector(1) - normalA.GetAbs() - normalB.GetAbs()), FVector(50)) + FVector(5);
-
-									//Add a helper vertex to keep the edges on the surfaces (except if the likely helper vertex is close to another one)
-									if (!a->isEdgeOverVoid(helperLocationA, vertexA->GetActorLocation()) && !b->isEdgeOverVoid(helperLocationA, vertexB->GetActorLocation()) && checkNearSurface(helperLocationA)) {
-										if (!a->isEdgeBlockedHelper(vertexA, vertexB, 0.25f) && !b->isEdgeBlockedHelper(vertexB, vertexA, 0.25f)) {
-											ESurfaceType transitionType = findTransitionType(surfaceA->surface, surfaceB->surface);
-											newHelperVertexA = createHelperVertex(surfaceB, helperLocationA, searchExtent, transitionType, newID, nextNewID, vertexA, vertexB);
-											newID = nextNewID;
-
-											//Create the edges (or any other helper vertex that is so close the new vertex wasn't made)
-											if (!a->doesEdgeExist(vertexA, newHelperVertexA)) {
-												helperEdgeA = a->generateEdge(vertexA, newHelperVertexA, newEdgeID, vertexA->surface, false);
-												if (helperEdgeA != nullptr) {
-													edges.AddUnique(helperEdgeA);
-													newEdgeID++;
-													addedEdge = true;
-												}
-											}
-											if (!b->doesEdgeExist(vertexB, newHelperVertexA)) {
-												helperEdgeB = b->generateEdge(vertexB, newHelperVertexA, newEdgeID, vertexB->surface, false);
-												if (helperEdgeB != nullptr) {
-													edges.AddUnique(helperEdgeB);
-													newEdgeID++;
-													addedEdge = true;
-												}
-											}
-										}
-									}
-								}
-
-								//A helper vertex is needed
-								else {
-									if (!a->doesEdgeExist(vertexA, vertexB) && !b->doesEdgeExist(vertexA, vertexB) && vertexA != vertexB) {
-										ESurfaceType transitionType = findTransitionType(surfaceA->surface, surfaceB->surface);
-										helperEdgeA = a->generateEdge(vertexA, vertexB, newEdgeID, transitionType, false);
-										if (helperEdgeA != nullptr) {
-											edges.AddUnique(helperEdgeA);
-											newEdgeID++;
-											addedEdge = true;
-										}
-									}
-								}
-							}
-						}
-					}
-					break;
+		//Find the PRM that has this vertex, if there is one. Note that only this PRM will need to be used for this vertex, so we break afterwards
+		for (int32 i = 0; i < PRMS.Num(); i++) {
+			if (prmVertices[i].Contains(connection.vertexA)) {
+				APRM* prmA = PRMS[i];
+				connectionPRMs[c] = i;
+
+				//Now find the neighbouring PRMs that contain the second vertex of the connection
+				for (int32 n = 0; n < prmA->neighbours.Num(); n++) {
+					const FPRMNeighbour& neighbourStruct = prmA->neighbours[n];
+					if (prmVertices.IsValidIndex(neighbourStruct.neighbourID) && prmVertices[neighbourStruct.neighbourID].Contains(connection.vertexB)) { neighbourCandidates[c].Add(n); }
 				}
 
-				//If an edge is added and b has not been handled yet, indicate that this connection has been made!
-				if (addedEdge && tempPRMS.Contains(b) && !connectedIDS.Contains(neighbourStruct.neighbourID)) {
-					madeConnections++;
-					connectedIDS.AddUnique(neighbourStruct.neighbourID);
-				}
+				break;
+			}
+		}
+	}, !parallelConnections);
+
+	//Make sure the surfaces are correct. This queries the physics scene, so it is done on this thread
+	for (int32 c = 0; c < interPRMConnections.num(); c++) {
+		if (connectionPRMs[c] == INDEX_NONE) { continue; }
+		const FPRMConnection& connection = interPRMConnections.get(c);
+		APRM* prmA = PRMS[connectionPRMs[c]];
+		for (int32 n : neighbourCandidates[c]) {
+			const FPRMNeighbour& neighbourStruct = prmA->neighbours[n];
+			APRM* prmB = PRMS[neighbourStruct.neighbourID];
+
+			//Find the surfaces of A and B that are used in this neighbour connection
+			ASurfaceArea* surfaceA = prmA->getSurfaceFromStruct(neighbourStruct);
+			ASurfaceArea* surfaceB = prmA->getNeighbourSurfaceFromStruct(prmB, neighbourStruct);
+
+			if ((prmA->checkIfInSurface(connection.vertexA, surfaceA) || prmA->checkIfInSurface(connection.vertexA, surfaceB)) && (prmB->checkIfInSurface(connection.vertexB, surfaceA) || prmB->checkIfInSurface(connection.vertexB, surfaceB))) {
+				connectionNeighbours[c] = n;
+				break;
 			}
-		}*/
+		}
+	}
 
-		//Remove a from the temporary array, since it has already been connected to its neighbours
-		//if (tempPRMS.Contains(a)) { tempPRMS.Remove(a); }
+	resolveTime = FDateTime::Now() - phaseStart;
+	phaseStart = FDateTime::Now();
+
+	//Keep track of which vertices are already connected, so a pair is only connected if it joins two parts of the roadmap. Helper vertices are added as their edges are made
+	FUnionFind roadmapComponents;
+	skippedConnections = 0;
+	if (componentAwareEdges) {
+		roadmapComponents.init(startVertexID);
+		for (APRM* PRM : PRMS) {
+			for (APRMEdge* edge : PRM->edges) { if (edge && edge->endVertices.Num() > 1) { roadmapComponents.merge(edge->endVertices[0], edge->endVertices[1]); } }
 		}
 	}
 
-	//Go over all pairs of vertices that might be feasible to connect
-	for (FPRMConnection connection : interPRMConnections) {
+	//Connect the pairs in the order of the connections. Helper vertices can be shared by several connections, so this is done one connection after the other
+	for (int32 c = 0; c < interPRMConnections.num(); c++) {
+		if (connectionNeighbours[c] == INDEX_NONE) { continue; }
+		const FPRMConnection& connection = interPRMConnections.get(c);
+		APRM* prmA = PRMS[connectionPRMs[c]];
+		const FPRMNeighbour& neighbourStruct = prmA->neighbours[connectionNeighbours[c]];
+		APRM* prmB = PRMS[neighbourStruct.neighbourID];
+
+		//Create sets to indicate two prms are connected
+		TSet<APRM*> newConnection; newConnection.Add(prmA); newConnection.Add(prmB);
+
+		//Try to connect the two prms
+		ASurfaceArea* surfaceA = prmA->getSurfaceFromStruct(neighbourStruct);
+		ASurfaceArea* surfaceB = prmA->getNeighbourSurfaceFromStruct(prmB, neighbourStruct);
+		//A pair that is already connected through other edges is not connected again, but does count as connected
+		bool alreadyJoined = componentAwareEdges && roadmapComponents.connected(connection.vertexA->id, connection.vertexB->id);
+		if (alreadyJoined) { skippedConnections++; }
+		int32 firstNewEdge = edges.Num();
+		bool addedEdge = alreadyJoined || connectTwoVertices(false, neighbourStruct, prmA, prmB, surfaceA, surfaceB, connection.vertexA, connection.vertexB);
+
+		//Only join along the edges that were made, since a single helper edge does not connect the pair
+		if (componentAwareEdges && !alreadyJoined) {
+			for (int32 e = firstNewEdge; e < edges.Num(); e++) {
+				if (edges[e] == nullptr || edges[e]->endVertices.Num() < 2) { continue; }
+				roadmapComponents.grow(FMath::Max(edges[e]->endVertices[0], edges[e]->endVertices[1]) + 1);
+				roadmapComponents.merge(edges[e]->endVertices[0], edges[e]->endVertices[1]);
+			}
+		}
 
-		//Find the PRM that has this vertex, if there is one. Note that only this PRM will need to be used for this vertex, so we break afterwards
-		for (APRM* prmA : PRMS) {
-			if (prmA->vertices.Contains(connection.vertexA)) {
-
-				//Now find the neighbouring PRM that contains the second vertex of the connection
-				APRM* prmB = nullptr;
-				bool addedEdge = false;
-				for (FPRMNeighbour neighbourStruct : prmA->neighbours) {
-					prmB = PRMS[neighbourStruct.neighbourID];
-
-					//Connect the two vertices if prmB contains the second vertex
-					if (prmB->vertices.Contains(connection.vertexB)) {
-						//Create sets to indicate two prms are connected
-						TSet<APRM*> newConnection; newConnection.Add(prmA); newConnection.Add(prmB);
-
-						//Find the surfaces of A and B that are used in this neighbour connection
-						ASurfaceArea* surfaceA = prmA->getSurfaceFromStruct(neighbourStruct);
-						ASurfaceArea* surfaceB = prmA->getNeighbourSurfaceFromStruct(prmB, neighbourStruct);
-
-						//Make sure the surfaces are correct
-						if ((prmA->checkIfInSurface(connection.vertexA, surfaceA) || prmA->checkIfInSurface(connection.vertexA, surfaceB)) && (prmB->checkIfInSurface(connection.vertexB, surfaceA) || prmB->checkIfInSurface(connection.vertexB, surfaceB))) {
-
-							//Try to connect the two prms
-							addedEdge = connectTwoVertices(false, neighbourStruct, prmA, prmB, surfaceA, surfaceB, connection.vertexA, connection.vertexB);
-
-							//If the two prms have been connected for the first time, add one to the counter
-							if (addedEdge) {
-								bool alreadyConnected = false;
-								for (TSet<APRM*> prmConnection : prmConnections) {
-									if (prmConnection.Contains(prmA) && prmConnection.Contains(prmB)) {
-										alreadyConnected = true;
-										break;
-									}
-								}
-								if (!alreadyConnected) {
-									prmConnections.Add(newConnection);
-									madeConnections++;
-								}
-							}
-							break;
-						}
-					}
-					if (prmB == nullptr) { UE_LOG(LogTemp, Log, TEXT("%s and %s are not in neighbouring PRMS"), *connection.vertexA->GetName(), *connection.vertexB->GetName()); }
+		//If the two prms have been connected for the first time, add one to the counter
+		if (addedEdge) {
+			bool alreadyConnected = false;
+			for (const TSet<APRM*>& prmConnection : prmConnections) {
+				if (prmConnection.Contains(prmA) && prmConnection.Contains(prmB)) {
+					alreadyConnected = true;
+					break;
 				}
-
-				break;
+			}
+			if (!alreadyConnected) {
+				prmConnections.Add(newConnection);
+				madeConnections++;
 			}
 		}
 	}
 
+	connectTime = FDateTime::Now() - phaseStart;
+
 	//If no edge has been generated yet and we want to guarantee a connection between the two PRMs, do so!
 	/*if (!addedEdge && guaranteeConnections) {
 		UE_LOG(LogTemp, Log, TEXT("PRMS are not yet connected. Add an edge!"));
@@ -631,7 +567,7 @@ void APRMCollector::connectPRMS()
 																if (!a->doesEdgeExist(extraVertexA, newHelperVertexA)) {
 																	helperEdgeA = a->generateEdge(extraVertexA, newHelperVertexA, newEdgeID, extraVertexA->surface, false);
 																	if (helperEdgeA != nullptr) {
-																		edges.AddUnique(helperEdgeA);
+																		addEdge(helperEdgeA);
 																		newEdgeID++;
 																		addedEdge = true;
 																	}
@@ -641,7 +577,7 @@ void APRMCollector::connectPRMS()
 																if (!b->doesEdgeExist(extraVertexB, newHelperVertexB)) {
 																	helperEdgeB = b->generateEdge(extraVertexB, newHelperVertexB, newEdgeID, extraVertexB->surface, false);
 																	if (helperEdgeB != nullptr) {
-																		edges.AddUnique(helperEdgeB);
+																		addEdge(helperEdgeB);
 																		newEdgeID++;
 																		addedEdge = true;
 																	}
@@ -651,7 +587,7 @@ void APRMCollector::connectPRMS()
 																if (!a->doesEdgeExist(newHelperVertexA, newHelperVertexB) && !a->isEdgeBlocked(newHelperVertexA, newHelperVertexB, 0.25f)) {
 																	helperEdgeC = a->generateEdge(newHelperVertexA, newHelperVertexB, newEdgeID, ESurfaceType::TransitionEdge, false);
 																	if (helperEdgeC != nullptr) {
-																		edges.AddUnique(helperEdgeC);
+																		addEdge(helperEdgeC);
 																		newEdgeID++;
 																		addedEdge = true;
 																	}
@@ -735,7 +671,7 @@ void APRMCollector::connectPRMS()
 																																													if (!a->doesEdgeExist(extraVertexA, newHelperVertexA) && isOnSurface(extraVertexA, newHelperVertexA)) {
 																																														helperEdgeA = a->generateEdge(extraVertexA, newHelperVertexA, newEdgeID, extraVertexA->surface, false);
 																																														if (helperEdgeA != nullptr) {
-																																															edges.AddUnique(helperEdgeA);
+																																															addEdge(helperEdgeA);
 																																															newEdgeID++;
 																																															addedEdge = true;
 																																														}
@@ -745,7 +681,7 @@ void APRMCollector::connectPRMS()
 																																													if (!b->doesEdgeExist(extraVertexB, newHelperVertexB) && isOnSurface(extraVertexB, newHelperVertexB)) {
 																																														helperEdgeB = b->generateEdge(extraVertexB, newHelperVertexB, newEdgeID, extraVertexB->surface, false);
 																																														if (helperEdgeB != nullptr) {
-																																															edges.AddUnique(helperEdgeB);
+																																															addEdge(helperEdgeB);
 																																															newEdgeID++;
 																																															addedEdge = true;
 																																														}
@@ -755,7 +691,7 @@ void APRMCollector::connectPRMS()
 																																													if (!a->doesEdgeExist(newHelperVertexA, newHelperVertexB) && isOnSurface(newHelperVertexA, newHelperVertexB)) {
 																																														helperEdgeC = a->generateEdge(newHelperVertexA, newHelperVertexB, newEdgeID, ESurfaceType::TransitionEdge, false);
 																																														if (helperEdgeC != nullptr) {
-																																															edges.Add(helperEdgeC);
+																																															addEdge(helperEdgeC);
 																																															newEdgeID++;
 																																															addedEdge = true;
 																																														}
@@ -796,7 +732,7 @@ void APRMCollector::connectPRMS()
 																																														if (!a->doesEdgeExist(extraVertexA, newHelperVertexA)) {
 																																															helperEdgeA = a->generateEdge(extraVertexA, newHelperVertexA, newEdgeID, extraVertexA->surface, false);
 																																															if (helperEdgeA != nullptr) {
-																																																edges.AddUnique(helperEdgeA);
+																																																addEdge(helperEdgeA);
 																																																newEdgeID++;
 																																																addedEdge = true;
 																																															}
@@ -804,7 +740,7 @@ void APRMCollector::connectPRMS()
 																																														if (!b->doesEdgeExist(extraVertexB, newHelperVertexA)) {
 																																															helperEdgeB = b->generateEdge(extraVertexB, newHelperVertexA, newEdgeID, extraVertexB->surface, false);
 																																															if (helperEdgeB != nullptr) {
-																																																edges.AddUnique(helperEdgeB);
+																																																addEdge(helperEdgeB);
 																																																newEdgeID++;
 																																																addedEdge = true;
 																																															}
@@ -818,7 +754,7 @@ void APRMCollector::connectPRMS()
 																																														transitionType = findTransitionType(surfaceA->surface, surfaceB->surface);
 																																														helperEdgeA = a->generateEdge(extraVertexA, extraVertexB, newEdgeID, transitionType, false);
 																																														if (helperEdgeA != nullptr) {
-																																															edges.AddUnique(helperEdgeA);
+																																															addEdge(helperEdgeA);
 																																															newEdgeID++;
 																																															addedEdge = true;
 																																														}
@@ -847,6 +783,7 @@ void APRMCollector::connectPRMS()
 
 	//Set the end time for the PRM generation
 	endTimeMoment = FDateTime::Now();
+	connectMemory = getUsedMemory() - startMemory;
 	FTimespan startTime = startTimeMoment.GetTimeOfDay();
 	FTimespan endTime = endTimeMoment.GetTimeOfDay();
 	FTimespan totalTime = endTime - startTime;
@@ -867,6 +804,30 @@ void APRMCollector::connectPRMS()
 		saveFile->edgeCount = edges.Num();
 		saveFile->madeConnections = madeConnections;
 		saveFile->totalConnections = totalConnections;
+		saveFile->generateMemory = generateMemory;
+		saveFile->connectMemory = connectMemory;
+		saveFile->generateTime = generateTime;
+		saveFile->candidateTime = candidateTime;
+		saveFile->resolveTime = resolveTime;
+		saveFile->connectTime = connectTime;
+		saveFile->buildSeed = buildSeed;
+		saveFile->lowDiscrepancySampling = lowDiscrepancySampling;
+		saveFile->poissonDiskSampling = poissonDiskSampling;
+		saveFile->adaptiveVertexBudget = adaptiveVertexBudget;
+		saveFile->fixedVertexCount = fixedVertexCount;
+		saveFile->verticesSaved = verticesSaved;
+		saveFile->componentAwareEdges = componentAwareEdges;
+		saveFile->skippedConnections = skippedConnections;
+		saveFile->skippedCandidates = 0;
+		for (APRM* PRM : PRMS) { saveFile->skippedCandidates += PRM->skippedCandidates; }
+		saveFile->narrowPassageSampling = narrowPassageSampling;
+		saveFile->biasedVertices = 0;
+		for (APRM* PRM : PRMS) { saveFile->biasedVertices += PRM->biasedVertices; }
+		countComponents();
+		saveFile->componentCount = componentCount;
+		saveFile->largestComponent = largestComponent;
+		saveFile->repairAttempts = repairAttempts;
+		saveFile->repairedVertices = repairedVertices;
 		if (!kNearestNeighbours3D) {
 			saveFile->clNearbyArea = notNearby;
 			saveFile->clFarApart = nearbyNotConnected;
@@ -886,19 +847,26 @@ void APRMCollector::reset()
 	projectionCuboids.Empty();
 
 	//Reset all PRMS
-	for (APRM* PRM : PRMS) { PRM->vertices.Empty(); PRM->edges.Empty(); }
+	for (APRM* PRM : PRMS) { PRM->vertices.Empty(); PRM->edges.Empty(); PRM->edgeIndex.Empty(); }
 	PRMS.Empty();
 
 	//Reset all vertices
 	for (AVertex* vertex : vertices) { if (vertex) { vertex->Destroy(); } }
 	vertices.Empty();
+	vertexSlots.Empty();
+	vertexTombstones = 0;
+	vertexTree.reset();
+	collisionBVH.reset();
 
 	//Reset all edges
 	for (APRMEdge* edge : edges) { if (edge) { edge->Destroy(); } }
 	edges.Empty();
+	edgeIndex.Empty();
+	lazyChecks = 0;
+	lazyRemovals = 0;
 
 	//Reset all interPRMConnections
-	interPRMConnections.Empty();
+	interPRMConnections.reset();
 }
 
 void APRMCollector::hidePRMS() {
@@ -912,11 +880,22 @@ void APRMCollector::showPRMS() {
 }
 
 void APRMCollector::calculateCoverSize() {
+	FDateTime coverStart = FDateTime::Now();
 	coverSize = 0;
 	totalSurfaceSize = 0;
 
-	//Calculate the size of a cover of each PRM and also add the PRM surface size to the total
-	for (APRM* PRM : PRMS) { coverSize += PRM->calculateCoverSize(agentSize); totalSurfaceSize += PRM->totalSize; }
+	//The cover of a surface is made by the edges of its surface type, so sort the edges by type once
+	TMap<ESurfaceType, TArray<APRMEdge*>> typeEdges;
+	for (APRMEdge* edge : edges) { if (edge && edge->spline) { typeEdges.FindOrAdd(edge->surface).Add(edge); } }
+
+	//Every surface has its own raster, so the PRMS can be rasterized at the same time
+	TArray<float> prmCoverSizes;
+	prmCoverSizes.SetNumZeroed(PRMS.Num());
+	ParallelFor(PRMS.Num(), [&](int32 i) { prmCoverSizes[i] = PRMS[i]->calculateCoverSize(agentSize, coverCellSize, typeEdges); }, !parallelPRMs);
+
+	//Add the cover of each PRM and also add the PRM surface size to the total
+	for (int32 i = 0; i < PRMS.Num(); i++) { coverSize += prmCoverSizes[i]; totalSurfaceSize += PRMS[i]->totalSize; }
+	coverTime = FDateTime::Now() - coverStart;
 
 	//Save the cover size data
 	USaveGame* baseSaveFile = UGameplayStatics::LoadGameFromSlot(saveName, 0);
@@ -924,6 +903,8 @@ void APRMCollector::calculateCoverSize() {
 	if (saveFile) {
 		saveFile->areaCovered = coverSize;
 		saveFile->totalArea = totalSurfaceSize;
+		saveFile->coverCellSize = coverCellSize;
+		saveFile->coverTime = coverTime;
 		UGameplayStatics::SaveGameToSlot(saveFile, saveName, 0);
 	}
 
@@ -931,65 +912,467 @@ void APRMCollector::calculateCoverSize() {
 	else { UE_LOG(LogTemp, Log, TEXT("No save file found. Build data not saved.")); }
 }
 
-APRMEdge * APRMCollector::findEdge(int32 a, int32 b)
+void APRMCollector::renumberVertices()
 {
-	//Go over every edge and see if the vertices a and b are its endpoints
+	//Remove vertices that no longer exist before renumbering
+	vertices.Remove(nullptr);
+	if (vertices.Num() < 1) {
+		UE_LOG(LogTemp, Log, TEXT("There are no vertices to renumber."));
+		return;
+	}
+
+	//Measure the search time with the current numbering
+	FTimespan searchTimeBefore = measureSearchTime(searchBenchmarkCount);
+
+	//Find the bounding box of all vertices
+	FVector bsw = vertices[0]->GetActorLocation();
+	FVector tne = vertices[0]->GetActorLocation();
+	for (AVertex* vertex : vertices) {
+		bsw = bsw.ComponentMin(vertex->GetActorLocation());
+		tne = tne.ComponentMax(vertex->GetActorLocation());
+	}
+
+	//Pair every vertex with its Morton code and sort them along the curve. Ties are broken by the old ID to keep the order deterministic
+	TArray<TPair<uint32, AVertex*>> orderedVertices;
+	for (AVertex* vertex : vertices) { orderedVertices.Add(TPair<uint32, AVertex*>(findMortonCode(vertex->GetActorLocation(), bsw, tne - bsw), vertex)); }
+	orderedVertices.StableSort([](const TPair<uint32, AVertex*>& A, const TPair<uint32, AVertex*>& B)
+	{
+		if (A.Key == B.Key) { return A.Value->id < B.Value->id; }
+		return A.Key < B.Key;
+	});
+
+	//Mapping from the old ID to the new ID, which is the position on the curve
+	TMap<int32, int32> newIDs;
+	for (int32 i = 0; i < orderedVertices.Num(); i++) { newIDs.Add(orderedVertices[i].Value->id, i); }
+
+	//Put the vertices in curve order, such that the ID of each vertex is its index in the vertices array
+	vertices.Empty(orderedVertices.Num());
+	for (int32 i = 0; i < orderedVertices.Num(); i++) {
+		orderedVertices[i].Value->id = i;
+		vertices.Add(orderedVertices[i].Value);
+	}
+
+	//Remap the neighbours and edges to the new IDs
+	remapVertexIDs(newIDs);
+
+	//Measure the search time with the new numbering
+	FTimespan searchTimeAfter = measureSearchTime(searchBenchmarkCount);
+	UE_LOG(LogTemp, Log, TEXT("Renumbered %d vertices. Search time before: %s; after: %s"), vertices.Num(), *searchTimeBefore.ToString(), *searchTimeAfter.ToString());
+
+	//Save the search times
+	USaveGame* baseSaveFile = UGameplayStatics::LoadGameFromSlot(saveName, 0);
+	saveFile = (UPRMBuildSave*)baseSaveFile;
+	if (saveFile) {
+		saveFile->searchTimeBefore = searchTimeBefore;
+		saveFile->searchTimeAfter = searchTimeAfter;
+		UGameplayStatics::SaveGameToSlot(saveFile, saveName, 0);
+	}
+
+	//If no save file can be found, indicate this.
+	else { UE_LOG(LogTemp, Log, TEXT("No save file found. Build data not saved.")); }
+}
+
+void APRMCollector::compactVertexIDs()
+{
+	//Keep the order of the current IDs, but remove the gaps left by removed vertices
+	vertices.Remove(nullptr);
+	Algo::SortBy(vertices, [](AVertex* vertex) { return vertex->id; });
+
+	//Mapping from the old ID to the new ID, which is the position in the vertices array
+	TMap<int32, int32> newIDs;
+	for (int32 i = 0; i < vertices.Num(); i++) {
+		newIDs.Add(vertices[i]->id, i);
+		vertices[i]->id = i;
+	}
+
+	//Remap the neighbours and edges to the new IDs
+	remapVertexIDs(newIDs);
+}
+
+void APRMCollector::remapVertexIDs(const TMap<int32, int32>& newIDs)
+{
+	//Remap the neighbours of every vertex. Neighbours that no longer exist are dropped, since their old IDs could now belong to other vertices
+	for (AVertex* vertex : vertices) {
+		auto isRemoved = [&newIDs](int32 neighbourID) { return !newIDs.Contains(neighbourID); };
+		vertex->neighbours.RemoveAll(isRemoved);
+		vertex->possibleNeighbours.RemoveAll(isRemoved);
+		for (int32& neighbourID : vertex->neighbours) { neighbourID = newIDs[neighbourID]; }
+		for (int32& neighbourID : vertex->possibleNeighbours) { neighbourID = newIDs[neighbourID]; }
+
+		//A direction towards a vertex that no longer exists points to the vertex itself, like the direction of the goal
+		const int32* newDirection = newIDs.Find(vertex->dpDirection);
+		vertex->dpDirection = newDirection ? *newDirection : vertex->id;
+
+		//The neighbours are sorted so that they are visited in the order of the vertices array
+		vertex->neighbours.Sort();
+	}
+
+	//Remap the end vertices of every edge. The edges of the PRMS are also in the edges array, so only that array is used, such that every edge is remapped once
+	//Edges to vertices that no longer exist cannot be used, so they are removed
+	TArray<APRMEdge*> removedEdges;
 	for (APRMEdge* edge : edges) {
-		if (edge->isEndVertex(a)) {
-			if (edge->isEndVertex(b)) {
-				return edge;
-			}
+		if (edge == nullptr) { continue; }
+		bool removed = false;
+		for (int32& endVertex : edge->endVertices) {
+			if (const int32* newID = newIDs.Find(endVertex)) { endVertex = *newID; }
+			else { removed = true; }
 		}
+		if (removed) { removedEdges.Add(edge); }
+	}
+	for (APRMEdge* edge : removedEdges) {
+		edges.Remove(edge);
+		if (edge->prm) { edge->prm->edges.Remove(edge); }
+		edge->Destroy();
 	}
+	if (removedEdges.Num() > 0) { UE_LOG(LogTemp, Log, TEXT("Removed %d edges to vertices that no longer exist."), removedEdges.Num()); }
+
+	//The vertex slots and edge keys depend on the vertex IDs, so the indices have to be rebuilt
+	rebuildVertexIndex();
+	rebuildEdgeIndex();
+
+	//New vertices should be numbered after the remapped ones
+	startVertexID = vertices.Num();
+}
+
+APRMEdge * APRMCollector::findEdge(int32 a, int32 b)
+{
+	//addEdge and removeEdge keep the index up to date, so it only has to be built once
+	if (!edgeIndexValid) { rebuildEdgeIndex(); }
+
+	//Look up the edge with a and b as its endpoints
+	APRMEdge** edge = edgeIndex.Find(APRMEdge::getKey(a, b));
+	if (edge && *edge) { return *edge; }
 
 	//Edge cannot be found
 	UE_LOG(LogTemp, Log, TEXT("This edge does not exist according to findEdge. a: %d, b: %d"), a, b);
 	return nullptr;
 }
 
-void APRMCollector::applyOptions(FString fileName, bool project, bool maprm, bool approx, bool knn, bool knn3d, bool apsmo, bool assmo, bool guaneavert, bool guacon)
+void APRMCollector::addEdge(APRMEdge* edge)
+{
+	if (edge == nullptr) { return; }
+	edges.AddUnique(edge);
+	edgeIndex.Add(edge->getKey(), edge);
+}
+
+void APRMCollector::rebuildEdgeIndex()
+{
+	edgeIndex.Empty(edges.Num());
+	for (APRMEdge* edge : edges) { if (edge) { edgeIndex.Add(edge->getKey(), edge); } }
+	for (APRM* PRM : PRMS) { PRM->rebuildEdgeIndex(); }
+	edgeIndexValid = true;
+}
+
+void APRMCollector::countComponents()
+{
+	FUnionFind components;
+	for (APRMEdge* edge : edges) {
+		if (edge == nullptr || edge->endVertices.Num() < 2) { continue; }
+		components.grow(FMath::Max(edge->endVertices[0], edge->endVertices[1]) + 1);
+		components.merge(edge->endVertices[0], edge->endVertices[1]);
+	}
+
+	//Count the vertices in each part by its representative
+	TMap<int32, int32> componentSizes;
+	for (AVertex* vertex : vertices) { if (vertex) { componentSizes.FindOrAdd(components.find(vertex->id))++; } }
+	componentCount = componentSizes.Num();
+	largestComponent = 0;
+	for (const TPair<int32, int32>& componentSize : componentSizes) { largestComponent = FMath::Max(largestComponent, componentSize.Value); }
+}
+
+int64 APRMCollector::getUsedMemory()
+{
+	return (int64)FPlatformMemory::GetStats().UsedPhysical;
+}
+
+void APRMCollector::removeEdge(APRMEdge* edge)
+{
+	if (edge == nullptr) { return; }
+
+	//The vertices are no longer neighbours
+	if (edge->endVertices.Num() > 1) {
+		AVertex* a = getVertex(edge->endVertices[0]);
+		AVertex* b = getVertex(edge->endVertices[1]);
+		if (a) { a->neighbours.Remove(edge->endVertices[1]); }
+		if (b) { b->neighbours.Remove(edge->endVertices[0]); }
+	}
+
+	//Remove the edge from the indices of the collector and its PRM
+	edges.RemoveSingleSwap(edge);
+	edgeIndex.Remove(edge->getKey());
+	if (edge->prm) {
+		edge->prm->edges.RemoveSingleSwap(edge);
+		edge->prm->edgeIndex.Remove(edge->getKey());
+	}
+
+	edge->Destroy();
+}
+
+bool APRMCollector::validatePath(const TArray<int32>& path)
+{
+	bool returnValue = true;
+
+	//Check every unchecked edge between two consecutive vertices of the path
+	for (int32 i = 1; i < path.Num(); i++) {
+		APRMEdge* edge = findEdge(path[i - 1], path[i]);
+		if (edge == nullptr || !edge->unchecked || edge->prm == nullptr) { continue; }
+
+		lazyChecks++;
+		if (edge->prm->checkLazyEdge(getVertex(path[i - 1]), getVertex(path[i]), agentSize)) {
+			//The result is cached, so the edge is never checked again
+			edge->unchecked = false;
+		}
+		else {
+			removeEdge(edge);
+			lazyRemovals++;
+			returnValue = false;
+		}
+	}
+
+	return returnValue;
+}
+
+void APRMCollector::pruneRoadmap()
+{
+	spannerEdgesBefore = edges.Num();
+	pathLengthBefore = measurePathLength(searchBenchmarkCount, queryTimeBefore);
+
+	FSpannerGraph graph;
+	buildSpannerGraph(vertices, graph);
+
+	//Edges of helper vertices connect the PRMS and are always kept. The other edges are candidates, handled from short to long
+	//Unchecked lazy edges are kept as well, but left out of the graph: validatePath may remove them later, so no checked edge is pruned in their favour
+	TArray<APRMEdge*> candidates;
+	for (APRMEdge* edge : edges) {
+		if (!edge || edge->endVertices.Num() < 2 || edge->unchecked) { continue; }
+		int32 a = edge->endVertices[0];
+		int32 b = edge->endVertices[1];
+		if (!graph.exists.IsValidIndex(a) || !graph.exists.IsValidIndex(b) || !graph.exists[a] || !graph.exists[b]) { continue; }
+
+		if (graph.helpers[a] || graph.helpers[b]) {
+			graph.adjacency[a].Add(b);
+			graph.adjacency[b].Add(a);
+		}
+		else { candidates.Add(edge); }
+	}
+
+	candidates.Sort([&graph](const APRMEdge& A, const APRMEdge& B) {
+		float lengthA = FVector::DistSquared(graph.locations[A.endVertices[0]], graph.locations[A.endVertices[1]]);
+		float lengthB = FVector::DistSquared(graph.locations[B.endVertices[0]], graph.locations[B.endVertices[1]]);
+		if (lengthA == lengthB) { return A.id < B.id; }
+		return lengthA < lengthB;
+	});
+
+	//Greedy spanner: an edge is only kept if one of the agent types has no path within the stretch over the edges kept so far
+	FWalkerCostPolicy walker;
+	FClimberCostPolicy climber;
+	TSet<APRMEdge*> pruned;
+	for (APRMEdge* edge : candidates) {
+		int32 a = edge->endVertices[0];
+		int32 b = edge->endVertices[1];
+		if (isEdgeNeeded(walker, graph, a, b, spannerStretch) || isEdgeNeeded(climber, graph, a, b, spannerStretch)) {
+			graph.adjacency[a].Add(b);
+			graph.adjacency[b].Add(a);
+		}
+		else { pruned.Add(edge); }
+	}
+
+	//Remove the pruned edges all at once, so the edge arrays are only filtered once
+	for (APRMEdge* edge : pruned) {
+		AVertex* a = getVertex(edge->endVertices[0]);
+		AVertex* b = getVertex(edge->endVertices[1]);
+		if (a) { a->neighbours.Remove(edge->endVertices[1]); }
+		if (b) { b->neighbours.Remove(edge->endVertices[0]); }
+		edgeIndex.Remove(edge->getKey());
+		if (edge->prm) { edge->prm->edgeIndex.Remove(edge->getKey()); }
+	}
+	edges.RemoveAll([&pruned](APRMEdge* edge) { return pruned.Contains(edge); });
+	for (APRM* PRM : PRMS) { PRM->edges.RemoveAll([&pruned](APRMEdge* edge) { return pruned.Contains(edge); }); }
+	for (APRMEdge* edge : pruned) { edge->Destroy(); }
+
+	spannerEdgesAfter = edges.Num();
+	pathLengthAfter = measurePathLength(searchBenchmarkCount, queryTimeAfter);
+	UE_LOG(LogTemp, Log, TEXT("Pruned the roadmap from %d to %d edges with stretch %f. Query time before: %s; after: %s"), spannerEdgesBefore, spannerEdgesAfter, spannerStretch, *queryTimeBefore.ToString(), *queryTimeAfter.ToString());
+
+	//Save the pruning data
+	USaveGame* baseSaveFile = UGameplayStatics::LoadGameFromSlot(saveName, 0);
+	saveFile = (UPRMBuildSave*)baseSaveFile;
+	if (saveFile) {
+		saveFile->spannerPruning = spannerPruning;
+		saveFile->spannerStretch = spannerStretch;
+		saveFile->spannerEdgesBefore = spannerEdgesBefore;
+		saveFile->spannerEdgesAfter = spannerEdgesAfter;
+		saveFile->queryTimeBefore = queryTimeBefore;
+		saveFile->queryTimeAfter = queryTimeAfter;
+		saveFile->pathLengthBefore = pathLengthBefore;
+		saveFile->pathLengthAfter = pathLengthAfter;
+		UGameplayStatics::SaveGameToSlot(saveFile, saveName, 0);
+	}
+
+	//If no save file can be found, indicate this.
+	else { UE_LOG(LogTemp, Log, TEXT("No save file found. Build data not saved.")); }
+}
+
+void APRMCollector::applyOptions(const APRMGenerator* generator)
+{
+	saveName = generator->saveName;
+	projectOntoSurfaces = generator->projectOntoSurfaces;
+	useMedialAxis = generator->useMedialAxis;
+	approximateMedialAxis = generator->approximateMedialAxis;
+	kNearestNeighbours = generator->kNearestNeighbours;
+	kNearestNeighbours3D = generator->kNearestNeighbours3D;
+	allPartialSurfacesMinimumOne = generator->allPartialSurfacesMinimumOne;
+	allSubSurfacesMinimumOne = generator->allSubSurfacesMinimumOne;
+	guaranteeNearbyVertices = generator->guaranteeNearbyVertices;
+	guaranteeConnections = generator->guaranteeConnections;
+	spatialRenumbering = generator->spatialRenumbering;
+	parallelEdgeTraces = generator->parallelEdgeTraces;
+	analyticCollision = generator->analyticCollision;
+	obstaclesBlockEdges = generator->obstaclesBlockEdges;
+	lazyEdges = generator->lazyEdges;
+	parallelPRMs = generator->parallelPRMs;
+	parallelConnections = generator->parallelConnections;
+	buildSeed = generator->buildSeed;
+	lowDiscrepancySampling = generator->lowDiscrepancySampling;
+	poissonDiskSampling = generator->poissonDiskSampling;
+	freeSpaceSampling = generator->freeSpaceSampling;
+	adaptiveVertexBudget = generator->adaptiveVertexBudget;
+	coverageTarget = generator->coverageTarget;
+	coverCellSize = generator->coverCellSize;
+	spannerPruning = generator->spannerPruning;
+	spannerStretch = generator->spannerStretch;
+	componentAwareEdges = generator->componentAwareEdges;
+	narrowPassageSampling = generator->narrowPassageSampling;
+	narrowPassageShare = generator->narrowPassageShare;
+	repairAllSurfaces = generator->repairAllSurfaces;
+	minimumConnectionDegree = generator->minimumConnectionDegree;
+}
+
+void APRMCollector::generateAdaptivePRM()
+{
+	//The fixed-density build places vertexCount vertices in every PRM. The adaptive build spends that budget in rounds and may use up to twice as much
+	const int32 rounds = 8;
+	fixedVertexCount = 0;
+	int32 firstVertexID = startVertexID;
+	TArray<ASurfaceArea*> activeSurfaces;
+	for (APRM* PRM : PRMS) {
+		fixedVertexCount += PRM->vertexCount;
+		for (ASurfaceArea* surface : PRM->surfaces) {
+			if (!surface) { continue; }
+			surface->resetCoverage(agentSize / 2);
+			activeSurfaces.Add(surface);
+		}
+	}
+
+	TMap<ASurfaceArea*, float> lastCoverage;
+	TArray<int32> firstVertices;
+	TArray<int32> firstEdges;
+	firstVertices.SetNum(PRMS.Num());
+	firstEdges.SetNum(PRMS.Num());
+
+	for (int32 round = 0; round < 2 * rounds && activeSurfaces.Num() > 0; round++) {
+		TSet<ASurfaceArea*> active(activeSurfaces);
+		for (int32 i = 0; i < PRMS.Num(); i++) {
+			firstVertices[i] = PRMS[i]->vertices.Num();
+			firstEdges[i] = PRMS[i]->edges.Num();
+			startVertexID = PRMS[i]->generateAdaptiveVertices(startVertexID, agentSize, FMath::Max(1, PRMS[i]->vertexCount / rounds), active);
+		}
+
+		//Only the new vertices look for neighbours, then the new edges are added to the coverage
+		generateNewEdges(firstVertices);
+		for (int32 i = 0; i < PRMS.Num(); i++) { PRMS[i]->addEdgeCoverage(firstEdges[i], agentSize); }
+
+		//Stop with a surface once it is covered enough, or once it had its fixed share and another round barely helped
+		activeSurfaces.RemoveAll([&](ASurfaceArea* surface) {
+			float fraction = surface->coverage.coveredFraction();
+			bool done = fraction >= coverageTarget || (round >= rounds && fraction - lastCoverage.FindRef(surface) < 0.01f);
+			lastCoverage.Add(surface, fraction);
+			return done;
+		});
+	}
+
+	verticesSaved = fixedVertexCount - (startVertexID - firstVertexID);
+}
+
+void APRMCollector::generateAllEdges()
+{
+	TArray<int32> firstVertices;
+	firstVertices.Init(0, PRMS.Num());
+	generateNewEdges(firstVertices);
+}
+
+void APRMCollector::generateNewEdges(const TArray<int32>& firstVertices)
+{
+	for (int32 i = 0; i < PRMS.Num(); i++) { generatePRMEdges(PRMS[i], firstVertices[i]); }
+}
+
+void APRMCollector::generatePRMEdges(APRM* PRM, int32 firstVertex)
 {
-	saveName = fileName;
-	projectOntoSurfaces = project;
-	useMedialAxis = maprm;
-	approximateMedialAxis = approx;
-	kNearestNeighbours = knn;
-	kNearestNeighbours3D = knn3d;
-	allPartialSurfacesMinimumOne = apsmo;
-	allSubSurfacesMinimumOne = assmo;
-	guaranteeNearbyVertices = guaneavert;
-	guaranteeConnections = guacon;
+	//Planning checks the hits of the traces and the surfaces of the vertices, which reads the actors, so it happens on the game thread. Only the traces themselves run in parallel if parallelEdgeTraces is set
+	PRM->planEdges(agentSize, kNearestNeighbours, kNearestNeighbours3D, firstVertex);
+
+	//Actors can only be spawned on the game thread, so the planned edges are created afterwards in the planned order
+	startEdgeID = PRM->commitEdges(startEdgeID, interPRMConnections);
+}
+
+bool APRMCollector::isUnderConnected(AVertex* vertex, APRM* PRM)
+{
+	if (interPRMConnections.degree(vertex) >= minimumConnectionDegree) { return false; }
+
+	//Stairs are narrow, so every vertex on them should be connected to a neighbouring surface
+	if (PRM->surfaces[0]->surface == ESurfaceType::Stairs || PRM->surfaces[0]->surface == ESurfaceType::StairsCeiling) { return true; }
+	if (!repairAllSurfaces) { return false; }
+
+	//On other surfaces, only vertices near an overlap box with a neighbouring surface are expected to be connected
+	FVector location = vertex->GetActorLocation();
+	for (ASurfaceArea* surface : PRM->surfaces) {
+		for (const FSurfaceNeighbour& neighbour : surface->neighbours) {
+			FBox overlap(neighbour.tne.ComponentMin(neighbour.bsw), neighbour.tne.ComponentMax(neighbour.bsw));
+			if (overlap.ExpandBy(agentSize).IsInside(location)) { return true; }
+		}
+	}
+
+	return false;
+}
+
+void APRMCollector::repairUnderConnected()
+{
+	if (projectionCuboids.Num() < 1) { return; }
+
+	//The degree of every vertex is looked up in the connection set, so this is linear in the amount of vertices
+	for (APRM* PRM : PRMS) {
+		if (PRM->surfaces.Num() < 1) { continue; }
+
+		for (AVertex* vertex : PRM->vertices) {
+			if (!isUnderConnected(vertex, PRM)) { continue; }
+
+			int32 degree = interPRMConnections.degree(vertex);
+			startEdgeID = projectionCuboids[0]->connectVertex(vertex, PRM, startEdgeID, kNearestNeighbours, kNearestNeighbours3D, interPRMConnections);
+			repairAttempts++;
+			if (interPRMConnections.degree(vertex) > degree) { repairedVertices++; }
+		}
+	}
 }
 
 void APRMCollector::generateRandomPRM()
 {
 	//If the projection option is used, generate vertices based on projection
 	if (projectOntoSurfaces) {
-		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateRandomVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
+		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateRandomVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
 		
-		//KNN3D misses some connections due to the order of handling the stairs (random). Therefore, if there are no connections with a stair, try again since after handling the rest this should be possible
-		if (kNearestNeighbours3D) {
-			for (APRM* PRM : PRMS) {
-				if (PRM->surfaces[0]->surface == ESurfaceType::Stairs || PRM->surfaces[0]->surface == ESurfaceType::StairsCeiling) {
-					for (AVertex* vertex : PRM->vertices) {
-						bool isUsed = false;
-						for (FPRMConnection connection : interPRMConnections) {
-							if (connection.vertexA == vertex || connection.vertexB == vertex) { isUsed = true; break; }
-						}
-						int32 oldNum = interPRMConnections.Num();
-						if (!isUsed) { startEdgeID = projectionCuboids[0]->connectVertex(vertex, PRM, startEdgeID, kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections); }
-					}
-				}
-			}
-		}
+		//KNN3D misses some connections due to the order of handling the surfaces (random). Therefore, try again for under-connected vertices since after handling the rest this should be possible
+		if (kNearestNeighbours3D) { repairUnderConnected(); }
 	}
 
+	//Keep adding vertices until the surfaces are covered
+	else if (adaptiveVertexBudget) { generateAdaptivePRM(); }
+
 	//Projection is not used, so use the standard variant
 	else {
 		//Generate every PRM individually
 		for (APRM* PRM : PRMS) {
 			startVertexID = PRM->generateRandomVertices(startVertexID, agentSize, allPartialSurfacesMinimumOne, allSubSurfacesMinimumOne);
-			startEdgeID = PRM->generateEdges(startEdgeID, agentSize, interPRMConnections, interPRMConnections, kNearestNeighbours, kNearestNeighbours3D);
+			generatePRMEdges(PRM, 0);
 		}
 	}
 }
@@ -998,29 +1381,17 @@ void APRMCollector::generateApproximateMedialPRM()
 {
 	//If the projection option is used, generate vertices based on projection
 	if (projectOntoSurfaces) {
-		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateApproximateMedialVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
-
-		//KNN3D misses some connections due to the order of handling the stairs (random). Therefore, if there are no connections with a stair, try again since after handling the rest this should be possible
-		if (kNearestNeighbours3D) {
-			for (APRM* PRM : PRMS) {
-				if (PRM->surfaces[0]->surface == ESurfaceType::Stairs || PRM->surfaces[0]->surface == ESurfaceType::StairsCeiling) {
-					for (AVertex* vertex : PRM->vertices) {
-						bool isUsed = false;
-						for (FPRMConnection connection : interPRMConnections) {
-							if (connection.vertexA == vertex || connection.vertexB == vertex) { isUsed = true; break; }
-						}
-						if (!isUsed) { startEdgeID = projectionCuboids[0]->connectVertex(vertex, PRM, startEdgeID, kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections); }
-					}
-				}
-			}
-		}
+		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateApproximateMedialVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
+
+		//KNN3D misses some connections due to the order of handling the surfaces (random). Therefore, try again for under-connected vertices since after handling the rest this should be possible
+		if (kNearestNeighbours3D) { repairUnderConnected(); }
 	}
 
 	//Projection is not used, so use the standard variant
 	else {
 		for (APRM* PRM : PRMS) {
 			startVertexID = PRM->generateApproximateMedialVertices(startVertexID, agentSize);
-			startEdgeID = PRM->generateEdges(startEdgeID, agentSize, interPRMConnections, interPRMConnections, kNearestNeighbours, kNearestNeighbours3D);
+			generatePRMEdges(PRM, 0);
 		}
 	}
 }
@@ -1029,31 +1400,147 @@ void APRMCollector::generateExactMedialPRM()
 {
 	//If the projection option is used, generate vertices based on projection
 	if (projectOntoSurfaces) {
-		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateExactMedialVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
-
-		//KNN3D misses some connections due to the order of handling the stairs (random). Therefore, if there are no connections with a stair, try again since after handling the rest this should be possible
-		if (kNearestNeighbours3D) {
-			for (APRM* PRM : PRMS) {
-				if (PRM->surfaces[0]->surface == ESurfaceType::Stairs || PRM->surfaces[0]->surface == ESurfaceType::StairsCeiling) {
-					for (AVertex* vertex : PRM->vertices) {
-						bool isUsed = false;
-						for (FPRMConnection connection : interPRMConnections) {
-							if (connection.vertexA == vertex || connection.vertexB == vertex) { isUsed = true; break; }
-						}
-						if (!isUsed) { startEdgeID = projectionCuboids[0]->connectVertex(vertex, PRM, startEdgeID, kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, interPRMConnections); }
-					}
-				}
-			}
-		}
+		for (AProjectionCuboid* projector : projectionCuboids) { projector->generateExactMedialVertices(kNearestNeighbours, kNearestNeighbours3D, interPRMConnections, startVertexID, startEdgeID, startVertexID, startEdgeID); }
+
+		//KNN3D misses some connections due to the order of handling the surfaces (random). Therefore, try again for under-connected vertices since after handling the rest this should be possible
+		if (kNearestNeighbours3D) { repairUnderConnected(); }
 	}
 
 	//Projection is not used, so use the standard variant
 	else {
 		for (APRM* PRM : PRMS) {
 			startVertexID = PRM->generateExactMedialVertices(startVertexID, agentSize);
-			startEdgeID = PRM->generateEdges(startEdgeID, agentSize, interPRMConnections, interPRMConnections, kNearestNeighbours, kNearestNeighbours3D);
+			generatePRMEdges(PRM, 0);
+		}
+	}
+}
+
+void APRMCollector::saveEdgeTimes()
+{
+	USaveGame* baseSaveFile = UGameplayStatics::LoadGameFromSlot(saveName, 0);
+	saveFile = (UPRMBuildSave*)baseSaveFile;
+	if (saveFile) {
+		saveFile->edgeTimes.Empty();
+		for (APRM* PRM : PRMS) { saveFile->edgeTimes.Add(PRM->edgeTime); }
+		UGameplayStatics::SaveGameToSlot(saveFile, saveName, 0);
+	}
+	else { UE_LOG(LogTemp, Log, TEXT("No save file found. Build data not saved.")); }
+}
+
+void APRMCollector::buildFreeSpace()
+{
+	freeRectangles = 0;
+
+	//Any surface in the level blocks the others, like in isInOtherSurface
+	TArray<AActor*> temp;
+	TArray<ASurfaceArea*> surfaces;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), ASurfaceArea::StaticClass(), temp);
+	for (AActor* actor : temp) { surfaces.Add((ASurfaceArea*)actor); }
+
+	for (ASurfaceArea* surface : surfaces) {
+		surface->freeSpace = freeSpaceSampling;
+		if (!freeSpaceSampling) { surface->freeRectangles.Empty(); surface->freeSpaceTable.reset(); }
+	}
+	if (!freeSpaceSampling) { return; }
+
+	//Obstacle boxes are found in the same way as for the collision hierarchy. The room walls block like obstacles, as the EdgeTraceBlocker trace in isInObstacle does, so vertices keep the agent size away from them
+	TArray<FBox> obstacles;
+	findRoomBoxes(obstacles);
+	temp = {};
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AObstacle::StaticClass(), temp);
+	for (AActor* actor : temp) {
+		AObstacle* obstacle = (AObstacle*)actor;
+		obstacles.Add(FBox::BuildAABB(obstacle->GetActorLocation(), 50 * obstacle->size));
+	}
+
+	//Find the boxes of the cubes of every surface once, together with the bounds of the surface
+	TArray<TArray<FBox>> cubeBoxes;
+	TArray<FBox> surfaceBounds;
+	cubeBoxes.SetNum(surfaces.Num());
+	surfaceBounds.Init(FBox(ForceInit), surfaces.Num());
+	for (int32 i = 0; i < surfaces.Num(); i++) {
+		for (UStaticMeshComponent* cube : surfaces[i]->cubes) {
+			if (!cube) { continue; }
+			cubeBoxes[i].Add(cube->Bounds.GetBox());
+			surfaceBounds[i] += cubeBoxes[i].Last();
 		}
 	}
+
+	for (int32 i = 0; i < surfaces.Num(); i++) {
+		if (!surfaceBounds[i].IsValid) { continue; }
+
+		//Only the boxes near the surface can cut its cubes
+		FBox nearby = surfaceBounds[i].ExpandBy(FMath::Max(agentSize, 5.f) + 1);
+		TArray<FBox> nearbyObstacles;
+		TArray<FBox> nearbySurfaces;
+		for (const FBox& box : obstacles) { if (nearby.Intersect(box)) { nearbyObstacles.Add(box); } }
+		for (int32 j = 0; j < surfaces.Num(); j++) {
+			if (j == i || !nearby.Intersect(surfaceBounds[j])) { continue; }
+			for (const FBox& box : cubeBoxes[j]) { if (nearby.Intersect(box)) { nearbySurfaces.Add(box); } }
+		}
+
+		surfaces[i]->buildFreeSpace(nearbyObstacles, nearbySurfaces, agentSize);
+		freeRectangles += surfaces[i]->freeRectangles.Num();
+	}
+}
+
+void APRMCollector::seedRandomStreams()
+{
+	//Every object gets its own stream, so the vertices of one object do not depend on the order in which the others are sampled
+	for (APRM* PRM : PRMS) {
+		if (!PRM) { continue; }
+		PRM->random.seed(buildSeed, EBuildStream::PRM, PRM->id);
+		for (ASurfaceArea* surface : PRM->surfaces) {
+			if (!surface) { continue; }
+			surface->random.seed(buildSeed, EBuildStream::Surface, surface->id);
+			surface->halton.reset(surface->random);
+			surface->lowDiscrepancy = lowDiscrepancySampling;
+		}
+	}
+
+	//Cuboids have no ID, so their position in the array is used
+	for (int32 i = 0; i < projectionCuboids.Num(); i++) { if (projectionCuboids[i]) { projectionCuboids[i]->random.seed(buildSeed, EBuildStream::Cuboid, i); } }
+}
+
+void APRMCollector::buildCollisionBVH()
+{
+	TArray<FCollisionBox> boxes;
+
+	//Add the walls that exist in every room
+	TArray<FBox> roomBoxes;
+	findRoomBoxes(roomBoxes);
+	for (const FBox& box : roomBoxes) { boxes.Add(FCollisionBox(box, false)); }
+
+	//Add the obstacles. Their cube is scaled by the size of the obstacle
+	TArray<AActor*> temp;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AObstacle::StaticClass(), temp);
+	for (AActor* actor : temp) {
+		AObstacle* obstacle = (AObstacle*)actor;
+		boxes.Add(FCollisionBox(FBox::BuildAABB(obstacle->GetActorLocation(), 50 * obstacle->size), true));
+	}
+
+	collisionBVH.build(boxes);
+
+	//Only share the hierarchy if it should be used
+	for (APRM* PRM : PRMS) {
+		PRM->collisionBVH = analyticCollision ? &collisionBVH : nullptr;
+		PRM->obstaclesBlockEdges = obstaclesBlockEdges;
+	}
+}
+
+void APRMCollector::findRoomBoxes(TArray<FBox>& outBoxes)
+{
+	TArray<AActor*> temp;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), ABasicRoom::StaticClass(), temp);
+	for (AActor* actor : temp) {
+		ABasicRoom* room = (ABasicRoom*)actor;
+		if (room->hasNorthWall) { outBoxes.Add(room->northWall->Bounds.GetBox()); }
+		if (room->hasSouthWall) { outBoxes.Add(room->southWall->Bounds.GetBox()); }
+		if (room->hasEastWall) { outBoxes.Add(room->eastWall->Bounds.GetBox()); }
+		if (room->hasWestWall) { outBoxes.Add(room->westWall->Bounds.GetBox()); }
+		if (room->hasCeiling) { outBoxes.Add(room->ceiling->Bounds.GetBox()); }
+		if (room->hasFloor) { outBoxes.Add(room->floor->Bounds.GetBox()); }
+	}
 }
 
 void APRMCollector::reconnectPRM()
@@ -1065,7 +1552,9 @@ void APRMCollector::reconnectPRM()
 	for (APRM* PRM : PRMS) { 
 		for (APRMEdge* edge : PRM->edges) { edge->Destroy(); }
 		PRM->edges.Empty(); 
+		PRM->edgeIndex.Empty();
 		edges.Empty();
+		edgeIndex.Empty();
 		PRM->neighbours.Empty();
 	}
 
@@ -1073,24 +1562,32 @@ void APRMCollector::reconnectPRM()
 	TArray<AVertex*> tempVertices = vertices;
 	for (AVertex* vertex : tempVertices) {
 		vertex->neighbours.Empty();
-		if (vertex->GetClass() == AHelperVertex::StaticClass()) { vertices.Remove(vertex); vertex->Destroy(); }
+		if (vertex->GetClass() == AHelperVertex::StaticClass()) { removeVertex(vertex); vertex->Destroy(); }
 	}
 
+	//The helper vertices are gone, so the spatial index only holds the remaining vertices
+	rebuildVertexTree();
+
 	//Prepare all the surfaces
 	connectivityGraph->CollectSurfaces();
 	connectivityGraph->ConnectSurfaces();
+	buildConnectionFrames();
 
 	//Reset the inter prm connections
-	interPRMConnections = {};
+	interPRMConnections.reset();
 
 	//Set which PRMS are neighbours
 	setNeighboursPRMS(); 
 	
-	startVertexID = vertices.Num();
+	//The IDs of the remaining vertices are kept, so new vertices are numbered after the highest of them
+	rebuildVertexIndex();
+	startVertexID = vertexSlots.Num();
 	startEdgeID = 0;
 
 	//Now create the edges again
-	for (APRM* PRM : PRMS) { startEdgeID = PRM->generateEdges(startEdgeID, agentSize, interPRMConnections, interPRMConnections, kNearestNeighbours, kNearestNeighbours3D); }
+	buildCollisionBVH();
+	for (APRM* PRM : PRMS) { PRM->parallelEdgeTraces = parallelEdgeTraces; PRM->lazyEdges = lazyEdges; PRM->componentEdges = componentAwareEdges; }
+	generateAllEdges();
 
 	//Connect the partial PRMS
 	connectPRMS();
@@ -1100,7 +1597,7 @@ void APRMCollector::reconnectPRM()
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AVertex::StaticClass(), temp);
 	for (AActor* actor : temp) {
 		AVertex* newVertex = (AVertex*)actor;
-		if (newVertex != nullptr) { vertices.AddUnique(newVertex); }
+		if (newVertex != nullptr) { addVertex(newVertex); }
 	}
 
 	//Add all created edges into an array
@@ -1108,8 +1605,10 @@ void APRMCollector::reconnectPRM()
 	UGameplayStatics::GetAllActorsOfClass(GetWorld(), APRMEdge::StaticClass(), temp);
 	for (AActor* actor : temp) {
 		APRMEdge* newEdge = (APRMEdge*)actor;
-		if (newEdge != nullptr) { edges.AddUnique(newEdge); }
+		if (newEdge != nullptr) { addEdge(newEdge); }
 	}
+
+	saveEdgeTimes();
 }
 
 FVector APRMCollector::getPointProjectionOntoPlane(FVector planePos, FVector planeNormal, FVector point) {
@@ -1133,28 +1632,139 @@ FVector APRMCollector::pairwiseMult(FVector a, FVector b) {
 	return FVector(a.X * b.X, a.Y * b.Y, a.Z * b.Z);
 }
 
+void APRMCollector::buildConnectionFrames()
+{
+	connectionFrames.Empty();
+	if (!connectivityGraph) { return; }
+
+	//Surfaces by their ID, to find the surface of a neighbour struct
+	TMap<int32, ASurfaceArea*> surfacesByID;
+	for (ASurfaceArea* surface : connectivityGraph->surfaces) { if (surface) { surfacesByID.Add(surface->id, surface); } }
+
+	for (ASurfaceArea* surfaceA : connectivityGraph->surfaces) {
+		if (!surfaceA) { continue; }
+		for (const FSurfaceNeighbour& neighbour : surfaceA->neighbours) {
+			ASurfaceArea** surfaceB = surfacesByID.Find(neighbour.neighbourID);
+			TPair<ASurfaceArea*, ASurfaceArea*> key(surfaceA, surfaceB ? *surfaceB : nullptr);
+			if (!surfaceB || connectionFrames.Contains(key)) { continue; }
+			connectionFrames.Add(key, makeConnectionFrame(surfaceA, *surfaceB));
+		}
+	}
+}
+
+FConnectionFrame APRMCollector::makeConnectionFrame(ASurfaceArea* surfaceA, ASurfaceArea* surfaceB)
+{
+	FConnectionFrame frame;
+	frame.structA = surfaceA->getNeighbourFromID(surfaceB->id);
+	frame.structB = surfaceB->getNeighbourFromID(surfaceA->id);
+	frame.normalA = surfaceA->getNormal();
+	frame.normalB = surfaceB->getNormal();
+	if (frame.structA.cube == nullptr || frame.structB.cube == nullptr) { return frame; }
+
+	//For the extents of the surface cube and the overlap area
+	frame.overlapTNE = frame.structA.tne;
+	frame.overlapBSW = frame.structA.bsw;
+	FVector aTNE = frame.structA.cube->GetComponentLocation() + 50 * frame.structA.cube->GetComponentScale();
+	FVector aBSW = frame.structA.cube->GetComponentLocation() - 50 * frame.structA.cube->GetComponentScale();
+	FVector bTNE = frame.structB.cube->GetComponentLocation() + 50 * frame.structB.cube->GetComponentScale();
+	FVector bBSW = frame.structB.cube->GetComponentLocation() - 50 * frame.structB.cube->GetComponentScale();
+
+	//The overlaps are different in case of the stairs
+	if (frame.structA.cm == EConnectionMethod::SCB && frame.structA.connectionCube) {
+		frame.overlapTNE = frame.structA.connectionCube->GetComponentLocation() + 50 * frame.structA.connectionCube->GetComponentScale();
+		frame.overlapBSW = frame.structA.connectionCube->GetComponentLocation() - 50 * frame.structA.connectionCube->GetComponentScale();
+	}
+
+	//Find the nearby areas for a and b (add to the TNE and BSW up to the maximum of the cube)
+	findTNEBSW(frame.overlapTNE, frame.overlapBSW, aTNE, aBSW, bTNE, bBSW, frame.aTNE, frame.aBSW, frame.bTNE, frame.bBSW);
+	findNearbyAreas(frame.overlapTNE, frame.overlapBSW, frame.aTNE, frame.aBSW, frame.bTNE, frame.bBSW, frame.overlapCenter, frame.overlapExtent, frame.aCenter, frame.aExtent, frame.bCenter, frame.bExtent);
+
+	//Find the normal of the side, which would be the direction from a to b if a is above
+	frame.normalC = findNormalC(frame.normalA, frame.aCenter, frame.bCenter);
+	frame.orthogonalAC = FVector::CrossProduct(frame.normalA, frame.normalC).GetAbs();
+
+	return frame;
+}
+
+const FConnectionFrame* APRMCollector::findConnectionFrame(ASurfaceArea* surfaceA, ASurfaceArea* surfaceB) const
+{
+	return connectionFrames.Find(TPair<ASurfaceArea*, ASurfaceArea*>(surfaceA, surfaceB));
+}
+
+bool APRMCollector::findConnectionCandidates(APRM* a, TArray<FPRMConnection>& outConnections)
+{
+	//Keeps track of the IDs of the PRMS that were connected to already.
+	TArray<int32> connectedIDS;
+
+	for (const FPRMNeighbour& neighbourStruct : a->neighbours) {
+		bool addedEdge = false;
+		if (neighbourStruct.neighbourID > 0 && neighbourStruct.neighbourID < PRMS.Num()) {
+			//Find the PRM related to this neighbour
+			APRM* b = PRMS[neighbourStruct.neighbourID];
+
+			//Find the surfaces of A and B that are used in this neighbour connection
+			ASurfaceArea* surfaceA = a->getSurfaceFromStruct(neighbourStruct);
+			ASurfaceArea* surfaceB = a->getNeighbourSurfaceFromStruct(b, neighbourStruct);
+
+			//Make sure surfaceB exists! If not, something went wrong with the surface connections!
+			if (!surfaceB) { UE_LOG(LogTemp, Log, TEXT("No surfaceB found! a: %s; Surface A: %s; id: %d; b: %s"), *a->GetName(), *surfaceA->GetName(), surfaceA->id, *b->GetName()); return false; }
+
+			//Find the connection frame and ensure that the cubes exist
+			const FConnectionFrame* frame = findConnectionFrame(surfaceA, surfaceB);
+			if (frame == nullptr || frame->structA.cube == nullptr) {
+				UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s to %s"), *surfaceA->GetName(), *surfaceB->GetName());
+				return false;
+			}
+			if (frame->structB.cube == nullptr) {
+				UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s from %s"), *surfaceB->GetName(), *surfaceA->GetName());
+				return false;
+			}
+			if (neighbourStruct.cm == EConnectionMethod::SCB && frame->structA.connectionCube == nullptr) {
+				UE_LOG(LogTemp, Log, TEXT("surfaceStructA does not have a connection cube: %s and %s"), *surfaceA->GetName(), *surfaceB->GetName());
+				return false;
+			}
+
+			///Declare all variables used in the case distinction!
+			//Arrays used for overlap functions
+			TArray<AVertex*> aVertices;
+			TArray<AVertex*> bVertices;
+
+			//Find all vertices in the nearby areas to (possibly) connect
+			findVertices(frame->aCenter, frame->aExtent, frame->bCenter, frame->bExtent, aVertices, bVertices);
+
+			//Prepare connections between vertex pairs
+			for (AVertex* vertexA : aVertices) {
+				for (AVertex* vertexB : bVertices) {
+					outConnections.Add(FPRMConnection(vertexA, vertexB));
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
 bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbourStruct, APRM * prmA, APRM * prmB, ASurfaceArea * surfaceA, ASurfaceArea * surfaceB, AVertex * vertexA, AVertex * vertexB)
 {
 	bool addedEdge = false;
-	//Find the surface structs and ensure that the cubes exist
-	FSurfaceNeighbour surfaceStructA = surfaceA->getNeighbourFromID(surfaceB->id);
-	if (surfaceStructA.cube == nullptr) {
+	//Find the connection frame and ensure that the cubes exist
+	const FConnectionFrame* frame = findConnectionFrame(surfaceA, surfaceB);
+	if (frame == nullptr || frame->structA.cube == nullptr) {
 		UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s to %s"), *surfaceA->GetName(), *surfaceB->GetName());
 		return false;
 	}
-	FSurfaceNeighbour surfaceStructB = surfaceB->getNeighbourFromID(surfaceA->id);
-	if (surfaceStructB.cube == nullptr) {
+	if (frame->structB.cube == nullptr) {
 		UE_LOG(LogTemp, Log, TEXT("No cube found! Surfaces: %s from %s"), *surfaceB->GetName(), *surfaceA->GetName());
 		return false;
 	}
+	const FSurfaceNeighbour& surfaceStructA = frame->structA;
+	const FSurfaceNeighbour& surfaceStructB = frame->structB;
 
-	//For defining the nearby areas and overlapping area
-	FVector overlapCenter = FVector(0);
-	FVector overlapExtentBox = FVector(0);
-	FVector aCenter = FVector(0);
-	FVector aExtentBox = FVector(0);
-	FVector bCenter = FVector(0);
-	FVector bExtentBox = FVector(0);
+	//The nearby areas and overlapping area only depend on the two surfaces, so they come from the frame
+	FVector overlapCenter = frame->overlapCenter;
+	FVector overlapExtentBox = frame->overlapExtent;
+	FVector aExtentBox = frame->aExtent;
+	FVector bExtentBox = frame->bExtent;
 
 	//Prepare the IDs for the vertices and edges
 	int32 newID = vertices.Num();
@@ -1162,8 +1772,8 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 	int32 newEdgeID = edges.Num();
 
 	//Normals and projections
-	FVector normalA = FVector(0);
-	FVector normalB = FVector(0);
+	FVector normalA = frame->normalA;
+	FVector normalB = frame->normalB;
 	FVector projectionA = FVector(0);
 	FVector projectionB = FVector(0);
 	FVector projectionA2 = FVector(0);
@@ -1180,22 +1790,12 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 	APRMEdge* helperEdgeC = nullptr;
 
 	//For the extents of the surface cube and the overlap area
-	FVector overlapTNE = surfaceStructA.tne;
-	FVector overlapBSW = surfaceStructA.bsw;
-	FVector aTNE = surfaceStructA.cube->GetComponentLocation() + 50 * surfaceStructA.cube->GetComponentScale();
-	FVector aBSW = surfaceStructA.cube->GetComponentLocation() - 50 * surfaceStructA.cube->GetComponentScale();
-	FVector bTNE = surfaceStructB.cube->GetComponentLocation() + 50 * surfaceStructB.cube->GetComponentScale();
-	FVector bBSW = surfaceStructB.cube->GetComponentLocation() - 50 * surfaceStructB.cube->GetComponentScale();
-
-	//The overlaps are different in case of the stairs
-	if (neighbourStruct.cm == EConnectionMethod::SCB) {
-		overlapTNE = surfaceStructA.connectionCube->GetComponentLocation() + 50 * surfaceStructA.connectionCube->GetComponentScale();
-		overlapBSW = surfaceStructA.connectionCube->GetComponentLocation() - 50 * surfaceStructA.connectionCube->GetComponentScale();
-	}
-
-	//Find the nearby areas for a and b (add to the TNE and BSW up to the maximum of the cube)
-	findTNEBSW(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, aTNE, aBSW, bTNE, bBSW);
-	findNearbyAreas(overlapTNE, overlapBSW, aTNE, aBSW, bTNE, bBSW, overlapCenter, overlapExtentBox, aCenter, aExtentBox, bCenter, bExtentBox);
+	const FVector& overlapTNE = frame->overlapTNE;
+	const FVector& overlapBSW = frame->overlapBSW;
+	const FVector& aTNE = frame->aTNE;
+	const FVector& aBSW = frame->aBSW;
+	const FVector& bTNE = frame->bTNE;
+	const FVector& bBSW = frame->bBSW;
 
 	//Connect the PRMS based on the connection method
 	switch (neighbourStruct.cm) {
@@ -1240,12 +1840,9 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 	case EConnectionMethod::SCB:
 		if (surfaceA->surface == ESurfaceType::Stairs || surfaceA->surface == ESurfaceType::StairsCeiling || surfaceB->surface == ESurfaceType::Stairs || surfaceB->surface == ESurfaceType::StairsCeiling) {
 			if (!checkDistance || (vertexA->GetActorLocation() - vertexB->GetActorLocation()).Size() < 400) {
-				//Find the projection of A onto the surface of B and vice versa
-				findNormals(neighbourStruct.cm, surfaceA, surfaceB, overlapCenter, vertexA, vertexB, normalA, normalB);
-
-				//Find the normal of the side, which would be the direction from a to b if a is above
-				FVector normalC = findNormalC(normalA, aCenter, bCenter);
-				FVector orthogonalAC = FVector::CrossProduct(normalA, normalC).GetAbs();
+				//The normal of the side, which would be the direction from a to b if a is above
+				FVector normalC = frame->normalC;
+				FVector orthogonalAC = frame->orthogonalAC;
 
 				//Project the vertices onto the sides of the surfaces
 				projectVerticesSCB(vertexA, vertexB, normalA, normalB, normalC, aExtentBox, bExtentBox, aTNE, aBSW, bTNE, bBSW, projectionA, projectionB);
@@ -1276,9 +1873,6 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 		//Direct Connection
 	case EConnectionMethod::Direct:
 		if (!checkDistance || (vertexA->GetActorLocation() - vertexB->GetActorLocation()).Size() < 400) {
-			//Find the projection of A onto the surface of B and vice versa
-			findNormals(neighbourStruct.cm, surfaceA, surfaceB, overlapCenter, vertexA, vertexB, normalA, normalB);
-
 			//Find the projections of the vertices onto each other's surfaces
 			findDirectProjection(vertexA, vertexB, normalA, normalB, overlapTNE, overlapBSW, projectionA, projectionB);
 
@@ -1303,7 +1897,7 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 						if (!prmA->doesEdgeExist(vertexA, newHelperVertexA)) {
 							helperEdgeA = prmA->generateEdge(vertexA, newHelperVertexA, newEdgeID, vertexA->surface, false);
 							if (helperEdgeA != nullptr) {
-								edges.AddUnique(helperEdgeA);
+								addEdge(helperEdgeA);
 								newEdgeID++;
 								addedEdge = true;
 							}
@@ -1311,7 +1905,7 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 						if (!prmB->doesEdgeExist(vertexB, newHelperVertexA)) {
 							helperEdgeB = prmB->generateEdge(vertexB, newHelperVertexA, newEdgeID, vertexB->surface, false);
 							if (helperEdgeB != nullptr) {
-								edges.AddUnique(helperEdgeB);
+								addEdge(helperEdgeB);
 								newEdgeID++;
 								addedEdge = true;
 							}
@@ -1326,7 +1920,7 @@ bool APRMCollector::connectTwoVertices(bool checkDistance, FPRMNeighbour neighbo
 					ESurfaceType transitionType = findTransitionType(surfaceA->surface, surfaceB->surface);
 					helperEdgeA = prmA->generateEdge(vertexA, vertexB, newEdgeID, transitionType, false);
 					if (helperEdgeA != nullptr) {
-						edges.AddUnique(helperEdgeA);
+						addEdge(helperEdgeA);
 						newEdgeID++;
 						addedEdge = true;
 					}
@@ -1368,18 +1962,9 @@ void APRMCollector::findNearbyAreas(FVector oTNE, FVector oBSW, FVector aTNE, FV
 
 void APRMCollector::findVertices(FVector aCenter, FVector aExtent, FVector bCenter, FVector bExtent, TArray<AVertex*>& outA, TArray<AVertex*>& outB)
 {
-	TArray<TEnumAsByte<EObjectTypeQuery>> traceObjectTypes;
-	traceObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldStatic));
-	
-	TArray<AActor*> ignores;
-	TArray<AActor*> aVertexActors;
-	TArray<AActor*> bVertexActors;
-	
-	UKismetSystemLibrary::BoxOverlapActors(GetWorld(), aCenter, aExtent, traceObjectTypes, AVertex::StaticClass(), ignores, aVertexActors);
-	UKismetSystemLibrary::BoxOverlapActors(GetWorld(), bCenter, bExtent, traceObjectTypes, AVertex::StaticClass(), ignores, bVertexActors);
-
-	for (AActor* actor : aVertexActors) { outA.Add((AVertex*)actor); }
-	for (AActor* actor : bVertexActors) { outB.Add((AVertex*)actor); }
+	//This is called from worker threads while the PRMS are connected, so the spatial index is used instead of overlap queries of the physics scene
+	vertexTree.findInBox(aCenter, aExtent, outA);
+	vertexTree.findInBox(bCenter, bExtent, outB);
 }
 
 void APRMCollector::findNormals(EConnectionMethod cm, ASurfaceArea * surfaceA, ASurfaceArea * surfaceB, FVector oCenter, AVertex * vertexA, AVertex * vertexB, FVector & normalA, FVector & normalB)
@@ -1725,7 +2310,7 @@ bool APRMCollector::connectHelperVertices(APRM* a, APRM* b, AVertex* vertexA, AV
 		if (!a->doesEdgeExist(vertexA, newVertexA) && !a->isEdgeBlockedHelper(vertexA, newVertexA, 0.25f)) {
 			edgeA = a->generateEdge(vertexA, newVertexA, newEdgeID, vertexA->surface, false);
 			if (edgeA != nullptr) {
-				edges.AddUnique(edgeA);
+				addEdge(edgeA);
 				edgeID++;
 				addedEdge = true;
 			}
@@ -1735,7 +2320,7 @@ bool APRMCollector::connectHelperVertices(APRM* a, APRM* b, AVertex* vertexA, AV
 		if (!b->doesEdgeExist(vertexB, newVertexB) && !b->isEdgeBlockedHelper(vertexB, newVertexB, 0.25f)) {
 			edgeB = b->generateEdge(vertexB, newVertexB, newEdgeID, vertexB->surface, false);
 			if (edgeB != nullptr) {
-				edges.AddUnique(edgeB);
+				addEdge(edgeB);
 				edgeID++;
 				addedEdge = true;
 			}
@@ -1745,7 +2330,7 @@ bool APRMCollector::connectHelperVertices(APRM* a, APRM* b, AVertex* vertexA, AV
 		if (!a->doesEdgeExist(newVertexA, newVertexB) && !a->isEdgeBlockedHelper(newVertexA, newVertexB, 0.25f)) {
 			edgeC = a->generateEdge(newVertexA, newVertexB, newEdgeID, ESurfaceType::TransitionEdge, false);
 			if (edgeC != nullptr) {
-				edges.AddUnique(edgeC);
+				addEdge(edgeC);
 				edgeID++;
 				addedEdge = true;
 			}
@@ -1765,7 +2350,7 @@ bool APRMCollector::connectHelperVerticesSingle(APRM* a, APRM* b, AVertex* verte
 		if (!a->doesEdgeExist(vertexA, newVertexA) && !a->isEdgeBlockedHelper(vertexA, newVertexA, 0.25f)) {
 			edgeA = a->generateEdge(vertexA, newVertexA, newEdgeID, vertexA->surface, false);
 			if (edgeA != nullptr) {
-				edges.AddUnique(edgeA);
+				addEdge(edgeA);
 				edgeID++;
 				addedEdge = true;
 			}
@@ -1775,7 +2360,7 @@ bool APRMCollector::connectHelperVerticesSingle(APRM* a, APRM* b, AVertex* verte
 		if (!b->doesEdgeExist(vertexB, newVertexB) && !b->isEdgeBlockedHelper(vertexB, newVertexB, 0.25f)) {
 			edgeB = b->generateEdge(vertexB, newVertexB, newEdgeID, vertexB->surface, false);
 			if (edgeB != nullptr) {
-				edges.AddUnique(edgeB);
+				addEdge(edgeB);
 				edgeID++;
 				addedEdge = true;
 			}
@@ -1813,11 +2398,12 @@ AVertex * APRMCollector::createHelperVertex(ASurfaceArea * surface, FVector loca
 		else if (nearbyHelpers.Num() > 0) { returnValue = (AHelperVertex*)nearbyHelpers[0]; }
 		else {
 			returnValue = surface->generateHelperVertex(inID, location, surfaceType, agentSize, true, goalA, goalB);
+			if (returnValue != nullptr) { vertexTree.insert(returnValue); }
 			outID = inID + 1;
 		}
 
 		//Add the generated vertex to the vertices array
-		if (returnValue != nullptr) { vertices.AddUnique(returnValue); }
+		if (returnValue != nullptr) { addVertex(returnValue); }
 	}
 
 	//Return the generated or nearby vertex.
@@ -1858,21 +2444,158 @@ AVertex* APRMCollector::findVertex(int32 findID) {
 AVertex* APRMCollector::getVertex(int32 getID) {
 	AVertex* returnValue = nullptr;
 
-	//Ensure the ID is in range
-	if (!vertices.IsValidIndex(getID)) {
-		UE_LOG(LogTemp, Log, TEXT("getID out of range. id: %d; vertices: %d"), getID, vertices.Num());
+	//The vertex index is not saved with the level, so build it on first use
+	if (vertexSlots.Num() < 1 && vertices.Num() > 0) { rebuildVertexIndex(); }
+
+	//Ensure the ID is in range and has not been removed
+	if (!vertexSlots.IsValidIndex(getID) || vertexSlots[getID] == INDEX_NONE) {
+		UE_LOG(LogTemp, Log, TEXT("getID is not present in the vertices array. id: %d; vertices: %d"), getID, vertices.Num());
 		return returnValue;
 	}
 
-	//Get the vertex at the position of the ID. If this vertex does not have the required ID, find it manually
-	returnValue = vertices[getID];
-	if (returnValue->id != getID) {	returnValue = findVertex(getID); }
+	//Get the vertex in the slot of the ID. If the vertices array was changed without updating the index, rebuild the index once
+	int32 slot = vertexSlots[getID];
+	if (!vertices.IsValidIndex(slot) || vertices[slot] == nullptr || vertices[slot]->id != getID) {
+		rebuildVertexIndex();
+		slot = vertexSlots.IsValidIndex(getID) ? vertexSlots[getID] : INDEX_NONE;
+		if (slot == INDEX_NONE) {
+			UE_LOG(LogTemp, Log, TEXT("getID is not present in the vertices array. id: %d"), getID);
+			return returnValue;
+		}
+	}
+	returnValue = vertices[slot];
+
+	return returnValue;
+
+}
+
+bool APRMCollector::addVertex(AVertex* vertex) {
+	if (vertex == nullptr || vertex->id < 0) { return false; }
+
+	//The vertex index is not saved with the level, so build it before extending it
+	if (vertexSlots.Num() < 1 && vertices.Num() > 0) { rebuildVertexIndex(); }
+
+	//Grow the index with tombstones up to the new ID
+	if (vertex->id >= vertexSlots.Num()) {
+		vertexTombstones += vertex->id - vertexSlots.Num();
+		while (vertexSlots.Num() <= vertex->id) { vertexSlots.Add(INDEX_NONE); }
+	}
+	else if (vertexSlots[vertex->id] == INDEX_NONE) { vertexTombstones--; }
+	else if (vertices.IsValidIndex(vertexSlots[vertex->id]) && vertices[vertexSlots[vertex->id]] == vertex) { return true; }
+	else if (!vertices.IsValidIndex(vertexSlots[vertex->id]) || vertices[vertexSlots[vertex->id]] == nullptr || vertices[vertexSlots[vertex->id]]->id != vertex->id) {
+		//The vertices array was changed without updating the index, so rebuild it and try again
+		rebuildVertexIndex();
+		return addVertex(vertex);
+	}
+	else {
+		//Another vertex already has this ID. The neighbours and edges refer to vertices by ID, so neither vertex can be renumbered here
+		UE_LOG(LogTemp, Error, TEXT("Vertex ID %d of %s is already used by %s. The vertex is not added."), vertex->id, *vertex->GetName(), *vertices[vertexSlots[vertex->id]]->GetName());
+		return false;
+	}
+
+	vertexSlots[vertex->id] = vertices.Add(vertex);
+	return true;
+}
+
+void APRMCollector::removeVertex(AVertex* vertex) {
+	if (vertex == nullptr || !vertexSlots.IsValidIndex(vertex->id)) { vertices.Remove(vertex); return; }
+
+	//Swap the last vertex into the slot of the removed vertex and leave a tombstone for the removed ID
+	int32 slot = vertexSlots[vertex->id];
+	if (!vertices.IsValidIndex(slot) || vertices[slot] != vertex) { vertices.Remove(vertex); rebuildVertexIndex(); return; }
+	vertices.RemoveAtSwap(slot);
+	if (vertices.IsValidIndex(slot) && vertices[slot] && vertexSlots.IsValidIndex(vertices[slot]->id)) { vertexSlots[vertices[slot]->id] = slot; }
+	vertexSlots[vertex->id] = INDEX_NONE;
+	vertexTombstones++;
+}
+
+void APRMCollector::rebuildVertexIndex() {
+	//Find the highest ID to size the index
+	int32 maxID = -1;
+	for (AVertex* vertex : vertices) { if (vertex) { maxID = FMath::Max(maxID, vertex->id); } }
+
+	//Every ID without a vertex is a tombstone
+	vertexSlots.Init(INDEX_NONE, maxID + 1);
+	for (int32 i = 0; i < vertices.Num(); i++) { if (vertices[i] && vertices[i]->id >= 0) { vertexSlots[vertices[i]->id] = i; } }
+	vertexTombstones = vertexSlots.Num() - vertices.Num();
+}
+
+void APRMCollector::rebuildVertexTree() {
+	vertexTree.build(vertices);
+
+	//Let the PRMs and projection cuboids use the same index, such that they also find each other's vertices
+	for (APRM* PRM : PRMS) { if (PRM) { PRM->vertexTree = &vertexTree; } }
+	for (AProjectionCuboid* cuboid : projectionCuboids) { if (cuboid) { cuboid->vertexTree = &vertexTree; } }
+}
 
-	//Give an error if the ID cannot be found in the array
-	if (returnValue == nullptr) { UE_LOG(LogTemp, Log, TEXT("getID is not present in the vertices array. id: %d"), getID); }
+uint32 APRMCollector::findMortonCode(FVector location, FVector bsw, FVector size) {
+	uint32 returnValue = 0;
+
+	//Scale each coordinate to a value between 0 and 1023 relative to the bounding box
+	FVector relative = location - bsw;
+	uint32 x = size.X > 0 ? (uint32)FMath::Clamp(FMath::FloorToInt(relative.X / size.X * 1023), 0, 1023) : 0;
+	uint32 y = size.Y > 0 ? (uint32)FMath::Clamp(FMath::FloorToInt(relative.Y / size.Y * 1023), 0, 1023) : 0;
+	uint32 z = size.Z > 0 ? (uint32)FMath::Clamp(FMath::FloorToInt(relative.Z / size.Z * 1023), 0, 1023) : 0;
+
+	//Interleave the bits of the three coordinates
+	for (int32 i = 0; i < 10; i++) {
+		returnValue |= ((x >> i) & 1) << (3 * i);
+		returnValue |= ((y >> i) & 1) << (3 * i + 1);
+		returnValue |= ((z >> i) & 1) << (3 * i + 2);
+	}
 
 	return returnValue;
+}
+
+FTimespan APRMCollector::measureSearchTime(int32 searchCount) {
+	//Time the A* of the agents. The vertex index is rebuilt before the searches, so both numberings look up the vertices directly
+	FTimespan searchTime;
+	measurePathLength(searchCount, searchTime);
+	return searchTime;
+}
+
+float APRMCollector::measurePathLength(int32 searchCount, FTimespan& outTime)
+{
+	outTime = FTimespan(0);
+	if (vertices.Num() < 2 || searchCount < 1) { return 0; }
+
+	//Run the A* of the agents with a temporary climbing agent, which may use every edge
+	AAgent* agent = GetWorld()->SpawnActor<AAgent>(FVector(0), FRotator(0), FActorSpawnParameters());
+	if (agent == nullptr) {
+		UE_LOG(LogTemp, Log, TEXT("Could not spawn an agent to measure the search time."));
+		return 0;
+	}
+	agent->prmCollector = this;
+	agent->canClimb = true;
+	agent->useCustomPenalties = false;
+
+	//Every lookup of the search goes through the vertex index, so make sure it is up to date before the timing starts
+	rebuildVertexIndex();
+
+	//Find a path between pairs of vertices that are spread over the vertices array. Only the searches themselves are timed
+	float totalLength = 0;
+	int32 foundPaths = 0;
+	for (int32 s = 0; s < searchCount; s++) {
+		int32 startIndex = (int32)(((int64)s * vertices.Num()) / searchCount);
+		AVertex* start = vertices[startIndex];
+		AVertex* goal = vertices[(startIndex + vertices.Num() / 2) % vertices.Num()];
+		if (start == nullptr || goal == nullptr || start == goal) { continue; }
+
+		FDateTime searchStart = FDateTime::Now();
+		bool found = agent->planPath(start->id, goal->id);
+		outTime += FDateTime::Now() - searchStart;
+		if (!found) { continue; }
+
+		for (int32 p = 1; p < agent->path.Num(); p++) {
+			AVertex* a = getVertex(agent->path[p - 1]);
+			AVertex* b = getVertex(agent->path[p]);
+			if (a && b) { totalLength += FVector::Dist(a->GetActorLocation(), b->GetActorLocation()); }
+		}
+		foundPaths++;
+	}
 
+	agent->Destroy();
+	return foundPaths > 0 ? totalLength / foundPaths : 0;
 }
 
 ESurfaceType APRMCollector::findTransitionType(ESurfaceType a, ESurfaceType b) {
@@ -2101,7 +2824,8 @@ int32 APRMCollector::generateExtraVertex(AVertex* &extraVertex, APRM* prm, ASurf
 	//Ensure the new vertex exists
 	if (extraVertex != nullptr) {
 		//Add the new vertex to the arrays and increase the ID
-		vertices.Add(extraVertex);
+		addVertex(extraVertex);
+		vertexTree.insert(extraVertex);
 		prm->vertices.Add(extraVertex);
 		newID++;
 
@@ -2184,7 +2908,7 @@ int32 APRMCollector::generateExtraEdge(AVertex * a, AVertex * b, APRM* prm, int3
 			b->neighbours.AddUnique(a->id);
 
 			//Add the edge to the array for this PRM
-			edges.AddUnique(newEdge);
+			addEdge(newEdge);
 			returnValue++;
 		}
 	}
@@ -13,6 +13,37 @@
 #include "PRMBuildSave.h"
 #include "PRMCollector.generated.h"
 
+class APRMGenerator;
+
+//Geometry of the connection from one surface to a neighbouring surface. It only depends on the two surfaces, so it is found once after the surfaces are connected instead of for every vertex pair
+struct FConnectionFrame {
+	//Neighbour structs of the surfaces for each other. The frame is only usable if both have a cube
+	FSurfaceNeighbour structA;
+	FSurfaceNeighbour structB;
+
+	//Overlap area and the nearby areas of both surfaces, limited to the cubes of the surfaces
+	FVector overlapTNE;
+	FVector overlapBSW;
+	FVector aTNE;
+	FVector aBSW;
+	FVector bTNE;
+	FVector bBSW;
+	FVector overlapCenter;
+	FVector overlapExtent;
+	FVector aCenter;
+	FVector aExtent;
+	FVector bCenter;
+	FVector bExtent;
+
+	//Normals of both surfaces
+	FVector normalA;
+	FVector normalB;
+
+	//Normal of the side around which stairs are connected and its orthogonal with normal A. Only used for single connection boxes
+	FVector normalC;
+	FVector orthogonalAC;
+};
+
 UCLASS()
 class DPP3DS_API APRMCollector : public AActor
 {
@@ -37,7 +68,30 @@ public:
 	UPROPERTY(EditAnywhere, Category = "PRM")
 		TArray<APRMEdge*> edges;
 
-		TArray<FPRMConnection> interPRMConnections;
+	//Mapping from the key of a vertex pair to the edge between them. Used by findEdge
+	TMap<uint64, APRMEdge*> edgeIndex;
+
+	//Whether the edge index holds the current edges. The index is not saved with the level, so it is rebuilt once after loading and after the vertex IDs change
+	bool edgeIndexValid;
+
+	//Mapping from the ID of a vertex to its index in the vertices array. Removed IDs are marked with INDEX_NONE. Used by getVertex
+	TArray<int32> vertexSlots;
+
+	//Spatial index over all vertices. Shared with the PRMs and projection cuboids to find nearby vertices during construction
+	FVertexTree vertexTree;
+
+	//Hierarchy over the boxes of the room walls and obstacles. Shared with the PRMs to check edges without physics traces
+	FCollisionBVH collisionBVH;
+
+	//Amount of IDs in the vertex index that no longer have a vertex
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 vertexTombstones;
+
+	//Pairs of vertices in neighbouring PRMS that should be connected
+	FPRMConnectionSet interPRMConnections;
+
+	//Connection frames of all pairs of neighbouring surfaces, from the first surface to the second
+	TMap<TPair<ASurfaceArea*, ASurfaceArea*>, FConnectionFrame> connectionFrames;
 
 	//Inverse of amount of vertices per cm^2
 	UPROPERTY(EditAnywhere, Category = "PRM")
@@ -91,6 +145,181 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Options")
 		bool guaranteeConnections;
 
+	//If true, the vertices are renumbered along a Morton curve after the build, such that vertices that are close in space have close IDs
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool spatialRenumbering;
+
+	//If true, the traces that check the candidate edges of a vertex are done in parallel
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelEdgeTraces;
+
+	//If true, blocked edges are found with a hierarchy over the room walls and obstacles instead of physics traces
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool analyticCollision;
+
+	//If true, obstacles block edges in the same way as room walls. Only used with analyticCollision
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool obstaclesBlockEdges;
+
+	//If true, edges within a PRM are not checked while building. An edge is checked the first time a path uses it
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool lazyEdges;
+
+	//If true, the covered area of the PRMS is calculated at the same time. The edges are planned one PRM after the other, since planning reads the hit actors
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelPRMs;
+
+	//If true, the candidate pairs and their PRMS are found at the same time while connecting the PRMS. The pairs are still connected one after the other
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelConnections;
+
+	//Seed of the random streams of the PRMS, surfaces and cuboids. Building twice with the same seed and options places the same vertices
+	UPROPERTY(EditAnywhere, Category = "Options")
+		int32 buildSeed;
+
+	//If true, vertices on the surfaces are placed along a Halton sequence instead of at random, which leaves fewer clumps and gaps
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool lowDiscrepancySampling;
+
+	//If true, random vertices are placed with Poisson-disk sampling and projected vertices are skipped, so no two vertices are closer than the agent size
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool poissonDiskSampling;
+
+	//If true, the free space of every surface is found before generating, so random vertices never land in obstacles and need no physics checks
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool freeSpaceSampling;
+
+	//If true, random vertices are added in rounds until the edges cover coverageTarget of every surface, instead of placing a fixed amount per PRM
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool adaptiveVertexBudget;
+
+	//Part of each surface the edges should cover before the adaptive vertex budget stops adding vertices to it
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float coverageTarget;
+
+	//Size of a cell of the raster used to calculate the covered area. Smaller cells give a more exact area but take longer
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float coverCellSize;
+
+	//If true, redundant edges are pruned after building, such that the shortest paths of every agent type get at most spannerStretch times longer
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool spannerPruning;
+
+	//Largest factor by which pruning may lengthen a shortest path
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float spannerStretch;
+
+	//If true, candidate edges and connections between PRMS are only checked if they join two parts of the roadmap that are not connected yet
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool componentAwareEdges;
+
+	//If true, part of the random vertices are placed near narrow passages (bridge test) and in the overlap boxes of neighbouring surfaces
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool narrowPassageSampling;
+
+	//Part of the random vertices placed near narrow passages and transitions with narrowPassageSampling
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float narrowPassageShare;
+
+	//If true, the KNN3D repair pass also retries vertices near neighbouring surfaces on all surface types instead of only the vertices on stairs
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool repairAllSurfaces;
+
+	//Amount of connections to other PRMS below which a vertex is retried by the KNN3D repair pass
+	UPROPERTY(EditAnywhere, Category = "Options")
+		int32 minimumConnectionDegree;
+
+	//Amount of unchecked edges that were checked while validating paths
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 lazyChecks;
+
+	//Amount of unchecked edges that turned out to be blocked and were removed
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 lazyRemovals;
+
+	//Amount of free rectangles over all surfaces. Only found with freeSpaceSampling
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 freeRectangles;
+
+	//Amount of vertices the fixed vertex density would have generated. Only set with adaptiveVertexBudget
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 fixedVertexCount;
+
+	//Amount of vertices the adaptive vertex budget generated less than the fixed vertex density. Negative if it generated more
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 verticesSaved;
+
+	//Amount of PRM connection pairs that were skipped since their vertices were already connected. Only counted with componentAwareEdges
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 skippedConnections;
+
+	//Amount of connected parts of the roadmap and the amount of vertices in the largest one
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 componentCount;
+
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 largestComponent;
+
+	//Amount of vertices the KNN3D repair pass retried and how many of them got a new connection
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 repairAttempts;
+
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 repairedVertices;
+
+	//Amount of edges before and after pruning. Only set with spannerPruning
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 spannerEdgesBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int32 spannerEdgesAfter;
+
+	//Time it took to find the benchmark shortest paths before and after pruning
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan queryTimeBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan queryTimeAfter;
+
+	//Average length of the benchmark shortest paths before and after pruning
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		float pathLengthBefore;
+
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		float pathLengthAfter;
+
+	//Change in used memory in bytes while generating the vertices and edges of the PRMS
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int64 generateMemory;
+
+	//Change in used memory in bytes while connecting the PRMS
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		int64 connectMemory;
+
+	//Time it took to generate the vertices and edges of the PRMS
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan generateTime;
+
+	//Time it took to find the pairs of vertices that might connect two PRMS
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan candidateTime;
+
+	//Time it took to find the PRMS and surfaces of those pairs
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan resolveTime;
+
+	//Time it took to connect the pairs with helper vertices and edges
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan connectTime;
+
+	//Time it took to calculate the covered area
+	UPROPERTY(VisibleAnywhere, Category = "Build Stats")
+		FTimespan coverTime;
+
+	//Amount of searches used to measure the search time before and after renumbering the vertices
+	UPROPERTY(EditAnywhere, Category = "Build Stats")
+		int32 searchBenchmarkCount;
+
 	//Save object and the values to use
 	UPRMBuildSave* saveFile;
 	FDateTime startTimeMoment;
@@ -140,13 +369,63 @@ public:
 	UFUNCTION(CallInEditor, Category = "Build Stats")
 		void calculateCoverSize();
 
+	//Renumbers all vertices along a Morton curve and remaps the neighbours and edges to the new IDs
+	UFUNCTION(CallInEditor, Category = "PRM")
+		void renumberVertices();
+
+	//Removes the edges that every agent type can replace by a path of at most spannerStretch times the cost of the edge
+	UFUNCTION(CallInEditor, Category = "PRM")
+		void pruneRoadmap();
+
+	//Renumbers all vertices to consecutive IDs in their current order, removing the gaps left by removed vertices
+	UFUNCTION(CallInEditor, Category = "PRM")
+		void compactVertexIDs();
+
+	//Changes the IDs used by the neighbours and edges from the old to the new vertex IDs and rebuilds the indices
+	void remapVertexIDs(const TMap<int32, int32>& newIDs);
+
 	//Finds an edge with given end vertices, if it exists
 	UFUNCTION(CallInEditor, Category = "PRM")
 		APRMEdge* findEdge(int32 a, int32 b);
 
-	//Finds an edge with given end vertices, if it exists
-	UFUNCTION(CallInEditor, Category = "Options")
-		void applyOptions(FString fileName, bool project, bool maprm, bool approx, bool knn, bool knn3d, bool apsmo, bool assmo, bool guaneavert, bool guacon);
+	//Adds an edge to the edges array and to the edge index
+	void addEdge(APRMEdge* edge);
+
+	//Rebuilds the edge index of the collector and of all PRMs from their edge arrays
+	void rebuildEdgeIndex();
+
+	//Finds the connected parts of the roadmap and sets componentCount and largestComponent
+	void countComponents();
+
+	//Memory in bytes currently used by the process. Used to measure the memory used by each build phase
+	static int64 getUsedMemory();
+
+	//Removes an edge from the roadmap, its PRM and the neighbours of its vertices, then destroys it
+	void removeEdge(APRMEdge* edge);
+
+	//Checks the unchecked edges on a path. Blocked edges are removed. Returns true if every edge of the path is valid
+	bool validatePath(const TArray<int32>& path);
+
+	//Copies the options of the generator
+	void applyOptions(const APRMGenerator* generator);
+
+	//Generates the edges of all PRMS once their vertices exist
+	void generateAllEdges();
+
+	//Generates the edges of the vertices of each PRM from its first vertex on, one PRM after the other
+	void generateNewEdges(const TArray<int32>& firstVertices);
+
+	//Plans the edges of the vertices of a PRM from its first vertex on and creates them
+	void generatePRMEdges(APRM* PRM, int32 firstVertex);
+
+	//Generates random vertices in rounds until the edges cover coverageTarget of every surface, instead of a fixed amount per PRM
+	void generateAdaptivePRM();
+
+	//Checks if a vertex of the PRM has fewer connections to other PRMS than it should. Every vertex on stairs should be connected, on other surfaces only the vertices near a neighbouring surface with repairAllSurfaces
+	bool isUnderConnected(AVertex* vertex, APRM* PRM);
+
+	//Tries to connect the under-connected vertices of all PRMS again after all vertices are placed. Used with projection and KNN3D
+	void repairUnderConnected();
 
 	//Generate a PRM with pure random sampling
 	void generateRandomPRM();
@@ -169,6 +448,18 @@ public:
 	//Multiplies two vectors pairwise by coordinate
 	FVector pairwiseMult(FVector a, FVector b);
 
+	//Finds the connection frames of all pairs of neighbouring surfaces. Called after the surfaces are connected
+	void buildConnectionFrames();
+
+	//Finds the geometry of the connection from surface A to neighbouring surface B
+	FConnectionFrame makeConnectionFrame(ASurfaceArea* surfaceA, ASurfaceArea* surfaceB);
+
+	//Connection frame from surface A to surface B, or nullptr if they are not neighbours
+	const FConnectionFrame* findConnectionFrame(ASurfaceArea* surfaceA, ASurfaceArea* surfaceB) const;
+
+	//Finds the pairs of vertices in the nearby areas of a PRM and its neighbours that might be connected. Returns false if the surfaces of a neighbour are not set up correctly
+	bool findConnectionCandidates(APRM* a, TArray<FPRMConnection>& outConnections);
+
 	//Connects two vertices
 	bool connectTwoVertices(bool checkDistance, FPRMNeighbour neighbourStruct, APRM* prmA, APRM* prmB, ASurfaceArea* surfaceA, ASurfaceArea* surfaceB, AVertex* vertexA, AVertex* vertexB);
 
@@ -230,6 +521,42 @@ public:
 	//Gets a vertex from the vertices array with a specific ID
 	AVertex* getVertex(int32 id);
 
+	//Adds a vertex to the vertices array and to the vertex index. Returns false if another vertex already has its ID
+	bool addVertex(AVertex* vertex);
+
+	//Removes a vertex from the vertices array and leaves a tombstone for its ID in the vertex index
+	void removeVertex(AVertex* vertex);
+
+	//Rebuilds the vertex index from the vertices array
+	void rebuildVertexIndex();
+
+	//Rebuilds the spatial index from the vertices array and shares it with the PRMs and projection cuboids
+	void rebuildVertexTree();
+
+	//Saves the time it took to generate the edges of each PRM
+	void saveEdgeTimes();
+
+	//Finds the free space of every surface from the obstacles and the other surfaces, or turns it off if freeSpaceSampling is false
+	void buildFreeSpace();
+
+	//Restarts the random streams and Halton sequences of all PRMS, their surfaces and the projection cuboids from the build seed
+	void seedRandomStreams();
+
+	//Builds the collision hierarchy from the walls of all rooms and all obstacles and shares it with the PRMs
+	void buildCollisionBVH();
+
+	//Finds the boxes of the walls, floors and ceilings of all rooms. The rooms are not rotated, so the bounds of a wall are its box
+	void findRoomBoxes(TArray<FBox>& outBoxes);
+
+	//Finds the Morton code of a location inside a bounding box, using 10 bits per axis
+	uint32 findMortonCode(FVector location, FVector bsw, FVector size);
+
+	//Measures the time the A* of a climbing agent takes to run a number of searches over the vertices
+	FTimespan measureSearchTime(int32 searchCount);
+
+	//Finds the average length of the paths the A* of a climbing agent finds between a number of pairs of vertices and the time the searches took
+	float measurePathLength(int32 searchCount, FTimespan& outTime);
+
 	//Finds the transition surface type based on two surfaces
 	ESurfaceType findTransitionType(ESurfaceType a, ESurfaceType b);
 
@@ -31,6 +31,9 @@ APRMEdge::APRMEdge()
 	spline->SetStartScale(FVector2D(0.08f));
 	spline->SetEndScale(FVector2D(0.08f));
 
+	unchecked = false;
+	prm = nullptr;
+
 	if (edgeVisibility) { showEdge(); }
 	else { hideEdge(); }
 }
@@ -84,6 +87,17 @@ bool APRMEdge::isEndVertex(int32 vertexID)
 	return endVertices.Contains(vertexID);
 }
 
+uint64 APRMEdge::getKey(int32 a, int32 b)
+{
+	return ((uint64)(uint32)FMath::Min(a, b) << 32) | (uint64)(uint32)FMath::Max(a, b);
+}
+
+uint64 APRMEdge::getKey()
+{
+	if (endVertices.Num() < 2) { return getKey(endVertices.Num() > 0 ? endVertices[0] : -1, endVertices.Num() > 0 ? endVertices[0] : -1); }
+	return getKey(endVertices[0], endVertices[1]);
+}
+
 void APRMEdge::setEdge(FVector vertexLocationA, FVector vertexLocationB) {
 	FVector localEnd = vertexLocationB - vertexLocationA;
 	FVector direction = localEnd.GetSafeNormal();
@@ -8,6 +8,8 @@
 #include "Components/SplineMeshComponent.h"
 #include "PRMEdge.generated.h"
 
+class APRM;
+
 UCLASS()
 class DPP3DS_API APRMEdge : public AActor
 {
@@ -33,6 +35,14 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Rendering")
 		int32 edgeVisibility;
 
+	//Whether the edge was generated without checking if it is blocked. Only used by the lazy PRM, which checks it once it is on a path
+	UPROPERTY(VisibleAnywhere, Category = "PRM")
+		bool unchecked;
+
+	//PRM that generated this edge. Used to check the edge later on
+	UPROPERTY(VisibleAnywhere, Category = "PRM")
+		APRM* prm;
+
 	//Spline that represents the edge (visually, only for testing purposes)
 	UPROPERTY(VisibleAnywhere, Category = "Rendering")
 		USplineMeshComponent* spline;
@@ -85,4 +95,10 @@ public:
 	// Creates the line
 	void setEdge(FVector vertexLocationA, FVector vertexLocationB);
 
+	// Key of the edge between vertices a and b in an edge index. The key is the same for (a, b) and (b, a)
+	static uint64 getKey(int32 a, int32 b);
+
+	// Key of this edge in an edge index
+	uint64 getKey();
+
 };
@@ -9,6 +9,25 @@ APRMGenerator::APRMGenerator()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
+	parallelEdgeTraces = true;
+	analyticCollision = false;
+	lazyEdges = false;
+	parallelPRMs = false;
+	parallelConnections = true;
+	buildSeed = 0;
+	lowDiscrepancySampling = false;
+	poissonDiskSampling = false;
+	freeSpaceSampling = false;
+	adaptiveVertexBudget = false;
+	coverageTarget = 0.9f;
+	coverCellSize = 5;
+	spannerPruning = false;
+	spannerStretch = 1.5f;
+	componentAwareEdges = false;
+	narrowPassageSampling = false;
+	narrowPassageShare = 0.3f;
+	repairAllSurfaces = false;
+	minimumConnectionDegree = 1;
 }
 
 // Called when the game starts or when spawned
@@ -30,6 +49,8 @@ void APRMGenerator::generatePRM() {
 	PRMCollector->setNeighboursPRMS();
 	PRMCollector->generatePRMS();
 	PRMCollector->connectPRMS();
+	if (PRMCollector->spannerPruning) { PRMCollector->pruneRoadmap(); }
+	if (PRMCollector->spatialRenumbering) { PRMCollector->renumberVertices(); }
 	PRMCollector->calculateCoverSize();
 }
 
@@ -61,8 +82,32 @@ void APRMGenerator::showStats() {
 		UE_LOG(LogTemp, Log, TEXT("Edge count: %d"), saveFile->edgeCount);
 		UE_LOG(LogTemp, Log, TEXT("Ratio of PRM connections: %d/%d"), saveFile->madeConnections, saveFile->totalConnections);
 		UE_LOG(LogTemp, Log, TEXT("Ratio of area covered: %f/%f"), saveFile->areaCovered, saveFile->totalArea);
+		UE_LOG(LogTemp, Log, TEXT("Covered area calculated with %f cells in %s"), saveFile->coverCellSize, *saveFile->coverTime.ToString());
 		UE_LOG(LogTemp, Log, TEXT("Nearby areas that had no vertices: %d"), saveFile->clNearbyArea);
 		UE_LOG(LogTemp, Log, TEXT("Partial PRMs that were not connected initially: %d"), saveFile->clFarApart);
+		UE_LOG(LogTemp, Log, TEXT("Search time before and after renumbering: %s / %s"), *saveFile->searchTimeBefore.ToString(), *saveFile->searchTimeAfter.ToString());
+		UE_LOG(LogTemp, Log, TEXT("Memory used by generating and connecting the PRMs: %lld / %lld bytes"), saveFile->generateMemory, saveFile->connectMemory);
+		UE_LOG(LogTemp, Log, TEXT("Phase times (generate / candidates / resolve / connect): %s / %s / %s / %s"), *saveFile->generateTime.ToString(), *saveFile->candidateTime.ToString(), *saveFile->resolveTime.ToString(), *saveFile->connectTime.ToString());
+		UE_LOG(LogTemp, Log, TEXT("Build seed: %d"), saveFile->buildSeed);
+		UE_LOG(LogTemp, Log, TEXT("Sampling: %s%s"), saveFile->poissonDiskSampling ? TEXT("Poisson disk") : saveFile->lowDiscrepancySampling ? TEXT("Halton") : TEXT("random"), saveFile->narrowPassageSampling ? TEXT(", biased towards narrow passages") : TEXT(""));
+		if (saveFile->adaptiveVertexBudget) { UE_LOG(LogTemp, Log, TEXT("Vertices saved by the adaptive budget: %d of %d"), saveFile->verticesSaved, saveFile->fixedVertexCount); }
+		if (saveFile->narrowPassageSampling) {
+			UE_LOG(LogTemp, Log, TEXT("Vertices placed near narrow passages and transitions: %d of %d"), saveFile->biasedVertices, saveFile->vertexCount);
+			UE_LOG(LogTemp, Log, TEXT("Vertices outside the largest connected part: %d of %d"), saveFile->vertexCount - saveFile->largestComponent, saveFile->vertexCount);
+			UE_LOG(LogTemp, Log, TEXT("Ratio of area covered with biased sampling: %f/%f"), saveFile->areaCovered, saveFile->totalArea);
+			UE_LOG(LogTemp, Log, TEXT("Nearby areas without vertices / PRMs not connected initially: %d / %d"), saveFile->clNearbyArea, saveFile->clFarApart);
+		}
+		UE_LOG(LogTemp, Log, TEXT("Connected parts of the roadmap / vertices in the largest part: %d / %d"), saveFile->componentCount, saveFile->largestComponent);
+		if (saveFile->repairAttempts > 0) { UE_LOG(LogTemp, Log, TEXT("Under-connected vertices retried / connected by the repair pass: %d / %d"), saveFile->repairAttempts, saveFile->repairedVertices); }
+		if (saveFile->componentAwareEdges) { UE_LOG(LogTemp, Log, TEXT("Candidate edges / connections skipped since they were already connected: %d / %d"), saveFile->skippedCandidates, saveFile->skippedConnections); }
+		if (saveFile->spannerPruning) {
+			UE_LOG(LogTemp, Log, TEXT("Edges before and after pruning with stretch %f: %d / %d"), saveFile->spannerStretch, saveFile->spannerEdgesBefore, saveFile->spannerEdgesAfter);
+			UE_LOG(LogTemp, Log, TEXT("Query time before and after pruning: %s / %s"), *saveFile->queryTimeBefore.ToString(), *saveFile->queryTimeAfter.ToString());
+			UE_LOG(LogTemp, Log, TEXT("Average path length before and after pruning: %f / %f"), saveFile->pathLengthBefore, saveFile->pathLengthAfter);
+		}
+		if (saveFile->vertexCount > 0) { UE_LOG(LogTemp, Log, TEXT("Area covered per vertex: %f"), saveFile->areaCovered / saveFile->vertexCount); }
+		if (saveFile->totalConnections > 0) { UE_LOG(LogTemp, Log, TEXT("Connection success: %f"), (float)saveFile->madeConnections / saveFile->totalConnections); }
+		for (int32 i = 0; i < saveFile->edgeTimes.Num(); i++) { UE_LOG(LogTemp, Log, TEXT("Edge generation time of PRM %d: %s"), i, *saveFile->edgeTimes[i].ToString()); }
 	}
 }
 
@@ -77,5 +122,5 @@ void APRMGenerator::showStatsCSV()
 
 void APRMGenerator::applyOptions()
 {
-	PRMCollector->applyOptions(saveName, projectOntoSurfaces, useMedialAxis, approximateMedialAxis, kNearestNeighbours, kNearestNeighbours3D, allPartialSurfacesMinimumOne, allSubSurfacesMinimumOne, guaranteeNearbyVertices, guaranteeConnections);
+	PRMCollector->applyOptions(this);
 }
@@ -59,6 +59,90 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Options")
 		bool guaranteeConnections;
 
+	//If true, the vertices are renumbered along a Morton curve after the build to keep vertices that are close in space close in memory
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool spatialRenumbering;
+
+	//If true, the traces that check the candidate edges of a vertex are done in parallel
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelEdgeTraces;
+
+	//If true, blocked edges are found with a hierarchy over the room walls and obstacles instead of physics traces
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool analyticCollision;
+
+	//If true, obstacles block edges in the same way as room walls. Only used with analyticCollision
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool obstaclesBlockEdges;
+
+	//If true, edges within a PRM are not checked while building. An edge is checked the first time a path uses it
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool lazyEdges;
+
+	//If true, the covered area of the PRMS is calculated at the same time. The edges are planned one PRM after the other, since planning reads the hit actors
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelPRMs;
+
+	//If true, the candidate pairs and their PRMS are found at the same time while connecting the PRMS. The pairs are still connected one after the other
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool parallelConnections;
+
+	//Seed of the random streams of the PRMS, surfaces and cuboids. Building twice with the same seed and options places the same vertices
+	UPROPERTY(EditAnywhere, Category = "Options")
+		int32 buildSeed;
+
+	//If true, vertices on the surfaces are placed along a Halton sequence instead of at random, which leaves fewer clumps and gaps
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool lowDiscrepancySampling;
+
+	//If true, random vertices are placed with Poisson-disk sampling and projected vertices are skipped, so no two vertices are closer than the agent size
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool poissonDiskSampling;
+
+	//If true, the free space of every surface is found before generating, so random vertices never land in obstacles and need no physics checks
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool freeSpaceSampling;
+
+	//If true, random vertices are added in rounds until the edges cover coverageTarget of every surface, instead of placing a fixed amount per PRM
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool adaptiveVertexBudget;
+
+	//Part of each surface the edges should cover before the adaptive vertex budget stops adding vertices to it
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float coverageTarget;
+
+	//Size of a cell of the raster used to calculate the covered area. Smaller cells give a more exact area but take longer
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float coverCellSize;
+
+	//If true, redundant edges are pruned after building, such that the shortest paths of every agent type get at most spannerStretch times longer
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool spannerPruning;
+
+	//Largest factor by which pruning may lengthen a shortest path
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float spannerStretch;
+
+	//If true, candidate edges and connections between PRMS are only checked if they join two parts of the roadmap that are not connected yet
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool componentAwareEdges;
+
+	//If true, part of the random vertices are placed near narrow passages (bridge test) and in the overlap boxes of neighbouring surfaces
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool narrowPassageSampling;
+
+	//Part of the random vertices placed near narrow passages and transitions with narrowPassageSampling
+	UPROPERTY(EditAnywhere, Category = "Options")
+		float narrowPassageShare;
+
+	//If true, the KNN3D repair pass also retries vertices near neighbouring surfaces on all surface types instead of only the vertices on stairs
+	UPROPERTY(EditAnywhere, Category = "Options")
+		bool repairAllSurfaces;
+
+	//Amount of connections to other PRMS below which a vertex is retried by the KNN3D repair pass
+	UPROPERTY(EditAnywhere, Category = "Options")
+		int32 minimumConnectionDegree;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -21,6 +21,9 @@ AProjectionCuboid::AProjectionCuboid()
 	box = CreateDefaultSubobject<UBoxComponent>(TEXT("Box"));
 	box->SetCollisionProfileName("NoCollision");
 	box->SetupAttachment(root);
+
+	vertexTree = nullptr;
+	poissonDisk = false;
 }
 
 // Called when the game starts or when spawned
@@ -130,7 +133,7 @@ APRM* AProjectionCuboid::findPRM(FVector traceStart, FVector traceEnd, TArray<AP
 	return nullptr;
 }
 
-void AProjectionCuboid::generateRandomVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID)
+void AProjectionCuboid::generateRandomVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID)
 {
 	int32 vertexID = inVertexID;
 	int32 edgeID = inEdgeID;
@@ -144,19 +147,19 @@ void AProjectionCuboid::generateRandomVertices(bool knn, bool knn3d, TArray<FPRM
 		FVector randomPoint = getRandomPointInCuboid();
 		
 		//For every surface that exists that can still have a vertex added, project this point to the appropriate surface
-		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurface(randomPoint, ceilingPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurface(randomPoint, floorPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurface(randomPoint, northPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurface(randomPoint, southPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurface(randomPoint, eastPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurface(randomPoint, westPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurface(randomPoint, ceilingPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurface(randomPoint, floorPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurface(randomPoint, northPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurface(randomPoint, southPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurface(randomPoint, eastPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurface(randomPoint, westPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
 	}
 
 	outVertexID = vertexID;
 	outEdgeID = edgeID;
 }
 
-void AProjectionCuboid::generateApproximateMedialVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID)
+void AProjectionCuboid::generateApproximateMedialVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID)
 {
 	int32 vertexID = inVertexID;
 	int32 edgeID = inEdgeID;
@@ -170,19 +173,19 @@ void AProjectionCuboid::generateApproximateMedialVertices(bool knn, bool knn3d,
 		FVector randomPoint = getRandomPointInCuboid();
 
 		//For every surface that exists that can still have a vertex added, project this point to the appropriate surface
-		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurfaceMedial(randomPoint, ceilingPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurfaceMedial(randomPoint, floorPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurfaceMedial(randomPoint, northPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurfaceMedial(randomPoint, southPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurfaceMedial(randomPoint, eastPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurfaceMedial(randomPoint, westPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurfaceMedial(randomPoint, ceilingPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurfaceMedial(randomPoint, floorPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurfaceMedial(randomPoint, northPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurfaceMedial(randomPoint, southPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurfaceMedial(randomPoint, eastPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurfaceMedial(randomPoint, westPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
 	}
 
 	outVertexID = vertexID;
 	outEdgeID = edgeID;
 }
 
-void AProjectionCuboid::generateExactMedialVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection>& outConnections, int32 inVertexID, int32 inEdgeID, int32 & outVertexID, int32 & outEdgeID)
+void AProjectionCuboid::generateExactMedialVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 & outVertexID, int32 & outEdgeID)
 {
 	int32 vertexID = inVertexID;
 	int32 edgeID = inEdgeID;
@@ -196,12 +199,12 @@ void AProjectionCuboid::generateExactMedialVertices(bool knn, bool knn3d, TArray
 		FVector randomPoint = getRandomPointInCuboid();
 
 		//For every surface that exists that can still have a vertex added, project this point to the appropriate surface
-		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurfaceExactMedial(randomPoint, ceilingPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurfaceExactMedial(randomPoint, floorPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurfaceExactMedial(randomPoint, northPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurfaceExactMedial(randomPoint, southPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurfaceExactMedial(randomPoint, eastPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
-		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurfaceExactMedial(randomPoint, westPRM, knn, knn3d, inConnections, outConnections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedCeiling < vertexCountZ && hasCeiling) { projectToSurfaceExactMedial(randomPoint, ceilingPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedFloor < vertexCountZ && hasFloor) { projectToSurfaceExactMedial(randomPoint, floorPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedNorthWall < vertexCountX && hasNorthWall) { projectToSurfaceExactMedial(randomPoint, northPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedSouthWall < vertexCountX && hasSouthWall) { projectToSurfaceExactMedial(randomPoint, southPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedEastWall < vertexCountY && hasEastWall) { projectToSurfaceExactMedial(randomPoint, eastPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
+		if (verticesGeneratedWestWall < vertexCountY && hasWestWall) { projectToSurfaceExactMedial(randomPoint, westPRM, knn, knn3d, connections, vertexID, edgeID, vertexID, edgeID); }
 	}
 
 	outVertexID = vertexID;
@@ -242,13 +245,14 @@ AVertex * AProjectionCuboid::generateVertex(FVector location, int32 vertexID, AP
 	//Add this vertex to the list of vertices in the prm
 	if (newVertex != nullptr) {
 		prm->vertices.AddUnique(newVertex);
+		if (vertexTree) { vertexTree->insert(newVertex); }
 		newID++;
 	}
 
 	return newVertex;
 }
 
-int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 edgeID, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections)
+int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 edgeID, bool knn, bool knn3d, FPRMConnectionSet& connections)
 {
 	int returnValue = edgeID;
 	TArray<AVertex*> possibleNeighbours;
@@ -258,16 +262,9 @@ int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 ed
 
 		//Find the extent of the overlap box to check for neighbours
 		FVector extent = FVector(5000);
-		possibleNeighbours = findNeighbours(newVertex, extent);
+		possibleNeighbours = findNeighbours(newVertex, extent, true);
 		//UE_LOG(LogTemp, Log, TEXT("Possible neighbours: %d"), possibleNeighbours.Num());
 
-		//Sort the neighbours so that the nearest neighbour is first in the array
-		Algo::SortBy(possibleNeighbours, [&](AVertex* vertexA)
-		{
-			const float& distance = (vertexA->GetActorLocation() - newVertex->GetActorLocation()).Size();
-			return distance;
-		});
-
 		int32 edgesGenerated = 0;
 
 		//Create an edge between two vertices if not blocked and not over a hole. Also make sure, since it's KNN, that 
@@ -283,8 +280,7 @@ int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 ed
 				else if (!prm->vertices.Contains(neighbour) && neighbour->GetClass() != AHelperVertex::StaticClass()) {
 					//Check if the neighbour is in a neighbouring surface
 					if (checkNeighbouringSurfaces(newVertex, neighbour)) {
-						FPRMConnection connection = FPRMConnection(newVertex, neighbour);
-						outConnections.Add(connection);
+						connections.add(newVertex, neighbour);
 						edgesGenerated++;
 						newVertex->possibleNeighbours.AddUnique(neighbour->id);
 					}
@@ -315,14 +311,7 @@ int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 ed
 		case ESurfaceType::StairsCeiling: extent.Z = 10; break;
 		default: break;
 		}
-		possibleNeighbours = findNeighbours(newVertex, extent);
-
-		//Sort the neighbours so that the nearest neighbour is first in the array
-		Algo::SortBy(possibleNeighbours, [&](AVertex* vertexA)
-		{
-			const float& distance = (vertexA->GetActorLocation() - newVertex->GetActorLocation()).Size();
-			return distance;
-		});
+		possibleNeighbours = findNeighbours(newVertex, extent, true);
 
 		int32 edgesGenerated = 0;
 
@@ -374,7 +363,7 @@ int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 ed
 		}
 
 		//Find the neighbours of this vertex
-		possibleNeighbours = findNeighbours(newVertex, extent);
+		possibleNeighbours = findNeighbours(newVertex, extent, false);
 
 		//Create an edge between two vertices if not blocked
 		for (AVertex* neighbour : possibleNeighbours) {
@@ -388,9 +377,22 @@ int32 AProjectionCuboid::connectVertex(AVertex * newVertex, APRM * prm, int32 ed
 	return returnValue;
 }
 
-TArray<AVertex*> AProjectionCuboid::findNeighbours(AVertex* newVertex, FVector extent) {
+TArray<AVertex*> AProjectionCuboid::findNeighbours(AVertex* newVertex, FVector extent, bool sortByDistance) {
 	//Overlapped vertices
 	TArray<AVertex*> returnValue;
+
+	//Use the spatial index if there is one, so the physics scene is not queried
+	if (vertexTree) {
+		TArray<AVertex*> found;
+		if (sortByDistance) { vertexTree->findNearestInBox(newVertex->GetActorLocation(), extent, found); }
+		else { vertexTree->findInBox(newVertex->GetActorLocation(), extent, found); }
+
+		//Skip the vertex itself
+		for (AVertex* vertex : found) { if (vertex != newVertex) { returnValue.AddUnique(vertex); } }
+
+		return returnValue;
+	}
+
 	TArray<AActor*> tempActors;
 
 	//Actors to ignore, so the vertex itself
@@ -407,10 +409,19 @@ TArray<AVertex*> AProjectionCuboid::findNeighbours(AVertex* newVertex, FVector e
 	//Cast to vertices
 	for (AActor* actor : tempActors) { returnValue.AddUnique((AVertex*)actor); }
 
+	//Sort the neighbours so that the nearest neighbour is first in the array
+	if (sortByDistance) {
+		Algo::SortBy(returnValue, [&](AVertex* vertexA)
+		{
+			const float& distance = (vertexA->GetActorLocation() - newVertex->GetActorLocation()).Size();
+			return distance;
+		});
+	}
+
 	return returnValue;
 }
 
-void AProjectionCuboid::projectToSurface(FVector point, APRM* prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
+void AProjectionCuboid::projectToSurface(FVector point, APRM* prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
 {
 	nextVertexID = vertexID;
 	nextEdgeID = edgeID;
@@ -456,11 +467,14 @@ void AProjectionCuboid::projectToSurface(FVector point, APRM* prm, bool knn, boo
 				break;
 			}
 
+			//Keep projected vertices at least the agent size apart
+			if (poissonDisk && vertexTree && vertexTree->hasVertexWithin(projectedPoint, agentSize)) { return; }
+
 			//Try to generate the new vertex
 			AVertex* newVertex = generateVertex(projectedPoint, vertexID, prm, surface);
 			if (newVertex != nullptr) {
 				nextVertexID = newVertex->id + 1;
-				nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, inConnections, outConnections);
+				nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, connections);
 
 				//Add 1 to the amount of vertices generated depending on which surface it is generated on
 				switch (surface) {
@@ -496,7 +510,7 @@ void AProjectionCuboid::projectToSurface(FVector point, APRM* prm, bool knn, boo
 	}
 }
 
-void AProjectionCuboid::projectToSurfaceMedial(FVector point, APRM* prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
+void AProjectionCuboid::projectToSurfaceMedial(FVector point, APRM* prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
 {
 	nextVertexID = vertexID;
 	nextEdgeID = edgeID;
@@ -564,7 +578,7 @@ void AProjectionCuboid::projectToSurfaceMedial(FVector point, APRM* prm, bool kn
 				AVertex* newVertex = generateVertex(projectedPoint, vertexID, prm, surface);
 				if (newVertex != nullptr) {
 					nextVertexID = newVertex->id + 1;
-					nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, inConnections, outConnections);
+					nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, connections);
 
 					//Add 1 to the amount of vertices generated depending on which surface it is generated on
 					switch (surface) {
@@ -601,7 +615,7 @@ void AProjectionCuboid::projectToSurfaceMedial(FVector point, APRM* prm, bool kn
 	}
 }
 
-void AProjectionCuboid::projectToSurfaceExactMedial(FVector point, APRM * prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection>& outConnections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
+void AProjectionCuboid::projectToSurfaceExactMedial(FVector point, APRM * prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 & nextVertexID, int32 & nextEdgeID)
 {
 	nextVertexID = vertexID;
 	nextEdgeID = edgeID;
@@ -661,11 +675,14 @@ void AProjectionCuboid::projectToSurfaceExactMedial(FVector point, APRM * prm, b
 
 			projectedPoint = surfaceArea->shiftToMedialAxis(projectedPoint);
 
+			//Keep projected vertices at least the agent size apart
+			if (poissonDisk && vertexTree && vertexTree->hasVertexWithin(projectedPoint, agentSize)) { return; }
+
 			//Try to generate the new vertex
 			AVertex* newVertex = generateVertex(projectedPoint, vertexID, prm, surface);
 			if (newVertex != nullptr) {
 				nextVertexID = newVertex->id + 1;
-				nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, inConnections, outConnections);
+				nextEdgeID = connectVertex(newVertex, prm, edgeID, knn, knn3d, connections);
 
 				//Add 1 to the amount of vertices generated depending on which surface it is generated on
 				switch (surface) {
@@ -686,7 +703,7 @@ void AProjectionCuboid::projectToSurfaceExactMedial(FVector point, APRM * prm, b
 
 FVector AProjectionCuboid::getRandomPointInCuboid()
 {
-	return FVector(FMath::RandRange(bsw.X + agentSize, tne.X - agentSize), FMath::RandRange(bsw.Y + agentSize, tne.Y - agentSize), FMath::RandRange(bsw.Z + agentSize, tne.Z - agentSize));
+	return FVector(random.frandRange(bsw.X + agentSize, tne.X - agentSize), random.frandRange(bsw.Y + agentSize, tne.Y - agentSize), random.frandRange(bsw.Z + agentSize, tne.Z - agentSize));
 }
 
 bool AProjectionCuboid::isEdgeBlocked(AVertex* a, AVertex* b) {
@@ -868,7 +885,7 @@ APRMEdge* AProjectionCuboid::generateEdge(AVertex* a, AVertex* b, int32 ID, APRM
 		b->neighbours.AddUnique(a->id);
 
 		//Add the edge to the array for this PRM
-		prm->edges.AddUnique(newEdge);
+		prm->addEdge(newEdge);
 		return newEdge;
 	}
 	return nullptr;
@@ -100,6 +100,15 @@ public:
 	UPROPERTY(EditAnywhere, Category = "PRM")
 		APRM* westPRM;
 
+	//Spatial index over all vertices, shared by the collector. Used to find nearby vertices without the physics scene
+	FVertexTree* vertexTree;
+
+	//Random stream of this cuboid, seeded by the collector from the build seed
+	FBuildRandom random;
+
+	//If true, a projected point is skipped when a vertex closer than the agent size already exists
+	bool poissonDisk;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -128,16 +137,16 @@ public:
 
 	void findPRMS(TArray<APRM*> prms);
 	APRM* findPRM(FVector traceStart, FVector traceEnd, TArray<APRM*> prms);
-	void generateRandomVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
-	void generateApproximateMedialVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
-	void generateExactMedialVertices(bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
+	void generateRandomVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
+	void generateApproximateMedialVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
+	void generateExactMedialVertices(bool knn, bool knn3d, FPRMConnectionSet& connections, int32 inVertexID, int32 inEdgeID, int32 &outVertexID, int32 &outEdgeID);
 	AVertex* createVertex(FVector location, ESurfaceType surface, int32 vertexID, bool showVertex);
 	AVertex* generateVertex(FVector location, int32 vertexID, APRM* prm, ESurfaceType surface);
-	int32 connectVertex(AVertex* newVertex, APRM* prm, int32 edgeID, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections);
-	TArray<AVertex*> findNeighbours(AVertex* newVertex, FVector extent);
-	void projectToSurface(FVector point, APRM* prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
-	void projectToSurfaceMedial(FVector point, APRM* prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
-	void projectToSurfaceExactMedial(FVector point, APRM* prm, bool knn, bool knn3d, TArray<FPRMConnection> inConnections, TArray<FPRMConnection> &outConnections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
+	int32 connectVertex(AVertex* newVertex, APRM* prm, int32 edgeID, bool knn, bool knn3d, FPRMConnectionSet& connections);
+	TArray<AVertex*> findNeighbours(AVertex* newVertex, FVector extent, bool sortByDistance);
+	void projectToSurface(FVector point, APRM* prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
+	void projectToSurfaceMedial(FVector point, APRM* prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
+	void projectToSurfaceExactMedial(FVector point, APRM* prm, bool knn, bool knn3d, FPRMConnectionSet& connections, int32 vertexID, int32 edgeID, int32 &nextVertexID, int32 &nextEdgeID);
 	FVector getRandomPointInCuboid();
 	bool isEdgeBlocked(AVertex* a, AVertex* b);
 	bool isEdgeOverVoid(FVector traceStart, FVector traceEnd);
@@ -13,20 +13,8 @@
 #include "Utils.h"
 #include "DrawDebugHelpers.h"
 
-//Sorts an array of polar representations of locations based on their angle with the minPoint
-struct FSortByAngle
-{
-	FSortByAngle(){}
-
-	bool operator()(FCartesianInPolar A, FCartesianInPolar B) const
-	{
-		if (A.angle == B.angle) {
-			return A.distance < B.distance;
-		}
-
-		return A.angle < B.angle;
-	}
-};
+//Largest amount of cells of the background grid of the Poisson-disk sampling
+static const int64 MaxPoissonCells = 16777216;
 
 //Sorts an array of 2D points by their y-value (or x if y is the same)
 struct FSortByYX
@@ -108,6 +96,36 @@ int32 findHelperOrientation(FVector2D vertex1, FVector2D vertex2, FVector2D vert
 	return returnValue;
 }
 
+//Removes the part of the pieces that lies within inPlane of the box, if the box is within outOfPlane of the height of the pieces
+static void subtractFootprint(TArray<FBox2D>& pieces, const FBox& box, int32 axisU, int32 axisV, int32 axisN, float height, float inPlane, float outOfPlane)
+{
+	if (height <= box.Min[axisN] - outOfPlane || height >= box.Max[axisN] + outOfPlane) { return; }
+	FBox2D footprint(FVector2D(box.Min[axisU] - inPlane, box.Min[axisV] - inPlane), FVector2D(box.Max[axisU] + inPlane, box.Max[axisV] + inPlane));
+
+	TArray<FBox2D> remaining;
+	auto addPiece = [&](FVector2D min, FVector2D max) { if (min.X < max.X && min.Y < max.Y) { remaining.Add(FBox2D(min, max)); } };
+
+	for (const FBox2D& piece : pieces) {
+		if (!piece.Intersect(footprint)) { remaining.Add(piece); continue; }
+
+		//Keep the strips before and after the footprint along V over the full width, and the strips beside it along U in between
+		float minV = FMath::Max(piece.Min.Y, footprint.Min.Y);
+		float maxV = FMath::Min(piece.Max.Y, footprint.Max.Y);
+		addPiece(piece.Min, FVector2D(piece.Max.X, footprint.Min.Y));
+		addPiece(FVector2D(piece.Min.X, footprint.Max.Y), piece.Max);
+		addPiece(FVector2D(piece.Min.X, minV), FVector2D(footprint.Min.X, maxV));
+		addPiece(FVector2D(footprint.Max.X, minV), FVector2D(piece.Max.X, maxV));
+	}
+
+	pieces = MoveTemp(remaining);
+}
+
+FFreeRectangle::FFreeRectangle(FBox2D inRectangle, int32 inCube)
+{
+	rectangle = inRectangle;
+	cube = inCube;
+}
+
 // Sets default values
 ASurfaceArea::ASurfaceArea()
 {
@@ -130,6 +148,9 @@ ASurfaceArea::ASurfaceArea()
 	RootComponent = root;
 	root->SetMobility(EComponentMobility::Static);
 
+	lowDiscrepancy = false;
+	freeSpace = false;
+
 	//Show the area in the environment the first time it is created
 	showArea(); 
 }
@@ -302,189 +323,41 @@ void ASurfaceArea::calculateWeights()
 		weight = weight / totalSize;
 		weights.Add(weight);
 	}
-}
-
-float ASurfaceArea::calculateCoverSize(float agentSize) {
-	totalCoverSize = 0;
-
-	//Output array
-	TArray<AActor*> overlaps;
-	TArray<APRMEdge*> overlappingEdges = {};
-
-	//Actors to ignore
-	TArray<AActor*> ignores;
-
-	//Object types to trace
-	TArray<TEnumAsByte<EObjectTypeQuery>> traceObjectTypes;
-	traceObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldDynamic));
-
-	//Find the area covering the edges on the surface using convex hull (Graham scan)
-	for (int c = 0; c < cubes.Num(); c++) {
-		UStaticMeshComponent* cube = cubes[c];
-		//Find the extent of the cube
-		FVector extent = FVector(50 * cube->GetComponentScale().X, 50 * cube->GetComponentScale().Y, 50 * cube->GetComponentScale().Z);
-		FVector absoluteMin = cube->GetComponentLocation() - FVector(50 * cube->GetComponentScale().X, 50 * cube->GetComponentScale().Y, 50 * cube->GetComponentScale().Z);
-		if (getNormal().X != 0) { absoluteMin.X = cube->GetComponentLocation().X; }
-		else if (getNormal().Y != 0) { absoluteMin.Y = cube->GetComponentLocation().Y; }
-		else if (getNormal().Z != 0) { absoluteMin.Z = cube->GetComponentLocation().Z; }
-
-		//All vertices of the cover areas
-		TArray<FVector> coverVertices;
-
-		//Find all edges overlapping the cube
-		UKismetSystemLibrary::BoxOverlapActors(GetWorld(), cube->GetComponentLocation(), extent, traceObjectTypes, false, ignores, overlaps);
-		
-		//Convert the overlaps to edges
-		for (AActor* actor : overlaps) {
-			if (actor->GetClass() == APRMEdge::StaticClass()) { 
-				APRMEdge* edge = (APRMEdge*)actor;
-				if (edge->surface == this->surface) { overlappingEdges.AddUnique((APRMEdge*)actor); }
-			}
-		}
-
-		//Create a cover area for each edge
-		for (APRMEdge* edge : overlappingEdges) {
-			//Rotation such that the area is in line with the edge. X-axis is now forward, Y is now side, Z is now height
-			FRotator spawnRotation = UKismetMathLibrary::MakeRotFromXZ(edge->spline->GetEndPosition().GetSafeNormal(), getNormal());
-
-			//Find the corners of the cover area
-			FVector backLeft = edge->GetActorLocation() - spawnRotation.RotateVector(FVector(agentSize, agentSize, 0));;
-			FVector backRight = edge->GetActorLocation() - spawnRotation.RotateVector(FVector(agentSize, -agentSize, 0));;
-			FVector endLeft = edge->GetActorLocation() + edge->spline->GetEndPosition() + spawnRotation.RotateVector(FVector(agentSize, -agentSize, 0));
-			FVector endRight = edge->GetActorLocation() + edge->spline->GetEndPosition() + spawnRotation.RotateVector(FVector(agentSize, agentSize, 0));
-			FVector spawnLocation = (backLeft + endRight) / 2;
-
-			//Limit the corners to the surface area
-			if (surface == ESurfaceType::Floor || surface == ESurfaceType::Ceiling || surface == ESurfaceType::Stairs || surface == ESurfaceType::StairsCeiling) {
-				//X and Y limitation
-				backLeft.X = FMath::Min(backLeft.X, cube->GetComponentLocation().X + extent.X); backLeft.X = FMath::Max(backLeft.X, cube->GetComponentLocation().X - extent.X);
-				backLeft.Y = FMath::Min(backLeft.Y, cube->GetComponentLocation().Y + extent.Y); backLeft.Y = FMath::Max(backLeft.Y, cube->GetComponentLocation().Y - extent.Y);
-				backLeft.Z = GetActorLocation().Z;
-				endLeft.X = FMath::Min(endLeft.X, cube->GetComponentLocation().X + extent.X); endLeft.X = FMath::Max(endLeft.X, cube->GetComponentLocation().X - extent.X);
-				endLeft.Y = FMath::Min(endLeft.Y, cube->GetComponentLocation().Y + extent.Y); endLeft.Y = FMath::Max(endLeft.Y, cube->GetComponentLocation().Y - extent.Y);
-				endLeft.Z = GetActorLocation().Z;
-				backRight.X = FMath::Min(backRight.X, cube->GetComponentLocation().X + extent.X); backRight.X = FMath::Max(backRight.X, cube->GetComponentLocation().X - extent.X);
-				backRight.Y = FMath::Min(backRight.Y, cube->GetComponentLocation().Y + extent.Y); backRight.Y = FMath::Max(backRight.Y, cube->GetComponentLocation().Y - extent.Y);
-				backRight.Z = GetActorLocation().Z;
-				endRight.X = FMath::Min(endRight.X, cube->GetComponentLocation().X + extent.X); endRight.X = FMath::Max(endRight.X, cube->GetComponentLocation().X - extent.X);
-				endRight.Y = FMath::Min(endRight.Y, cube->GetComponentLocation().Y + extent.Y); endRight.Y = FMath::Max(endRight.Y, cube->GetComponentLocation().Y - extent.Y);
-				endRight.Z = GetActorLocation().Z;
-			}
-			else if (surface == ESurfaceType::EastWall || surface == ESurfaceType::WestWall) {
-				//X and Z limitation
-				backLeft.X = FMath::Min(backLeft.X, cube->GetComponentLocation().X + extent.X); backLeft.X = FMath::Max(backLeft.X, cube->GetComponentLocation().X - extent.X);
-				backLeft.Y = GetActorLocation().Y;
-				backLeft.Z = FMath::Min(backLeft.Z, cube->GetComponentLocation().Z + extent.Z); backLeft.Z = FMath::Max(backLeft.Z, cube->GetComponentLocation().Z - extent.Z);
-				endLeft.X = FMath::Min(endLeft.X, cube->GetComponentLocation().X + extent.X); endLeft.X = FMath::Max(endLeft.X, cube->GetComponentLocation().X - extent.X);
-				endLeft.Y = GetActorLocation().Y;
-				endLeft.Z = FMath::Min(endLeft.Z, cube->GetComponentLocation().Z + extent.Z); endLeft.Z = FMath::Max(endLeft.Z, cube->GetComponentLocation().Z - extent.Z);
-				backRight.X = FMath::Min(backRight.X, cube->GetComponentLocation().X + extent.X); backRight.X = FMath::Max(backRight.X, cube->GetComponentLocation().X - extent.X);
-				backRight.Y = GetActorLocation().Y;
-				backRight.Z = FMath::Min(backRight.Z, cube->GetComponentLocation().Z + extent.Z); backRight.Z = FMath::Max(backRight.Z, cube->GetComponentLocation().Z - extent.Z);
-				endRight.X = FMath::Min(endRight.X, cube->GetComponentLocation().X + extent.X); endRight.X = FMath::Max(endRight.X, cube->GetComponentLocation().X - extent.X);
-				endRight.Y = GetActorLocation().Y;
-				endRight.Z = FMath::Min(endRight.Z, cube->GetComponentLocation().Z + extent.Z); endRight.Z = FMath::Max(endRight.Z, cube->GetComponentLocation().Z - extent.Z);
-			}
-			else if (surface == ESurfaceType::NorthWall || surface == ESurfaceType::SouthWall) {
-				//Y and Z limitation
-				backLeft.X = GetActorLocation().X;
-				backLeft.Y = FMath::Min(backLeft.Y, cube->GetComponentLocation().Y + extent.Y); backLeft.Y = FMath::Max(backLeft.Y, cube->GetComponentLocation().Y - extent.Y);
-				backLeft.Z = FMath::Min(backLeft.Z, cube->GetComponentLocation().Z + extent.Z); backLeft.Z = FMath::Max(backLeft.Z, cube->GetComponentLocation().Z - extent.Z);
-				endLeft.X = GetActorLocation().X;
-				endLeft.Y = FMath::Min(endLeft.Y, cube->GetComponentLocation().Y + extent.Y); endLeft.Y = FMath::Max(endLeft.Y, cube->GetComponentLocation().Y - extent.Y);
-				endLeft.Z = FMath::Min(endLeft.Z, cube->GetComponentLocation().Z + extent.Z); endLeft.Z = FMath::Max(endLeft.Z, cube->GetComponentLocation().Z - extent.Z);
-				backRight.X = GetActorLocation().X;
-				backRight.Y = FMath::Min(backRight.Y, cube->GetComponentLocation().Y + extent.Y); backRight.Y = FMath::Max(backRight.Y, cube->GetComponentLocation().Y - extent.Y);
-				backRight.Z = FMath::Min(backRight.Z, cube->GetComponentLocation().Z + extent.Z); backRight.Z = FMath::Max(backRight.Z, cube->GetComponentLocation().Z - extent.Z);
-				endRight.X = GetActorLocation().X;
-				endRight.Y = FMath::Min(endRight.Y, cube->GetComponentLocation().Y + extent.Y); endRight.Y = FMath::Max(endRight.Y, cube->GetComponentLocation().Y - extent.Y);
-				endRight.Z = FMath::Min(endRight.Z, cube->GetComponentLocation().Z + extent.Z); endRight.Z = FMath::Max(endRight.Z, cube->GetComponentLocation().Z - extent.Z);
-			}
-
-			//Add the corners to the vertices
-			coverVertices.Add(backLeft); coverVertices.Add(backRight); coverVertices.Add(endLeft); coverVertices.Add(endRight);
-		}
-
-		//Create a convex hull from the cover vertices
-		TArray<FCartesianInPolar> stack;
-		if (coverVertices.Num() > 2) {
-			FVector minPoint = coverVertices[0];
-
-			//Find the lowest point (in order Z, Y, X)
-			for (FVector vertex : coverVertices) {
-				if (vertex.Z < minPoint.Z) { minPoint = vertex; }
-				else if (vertex.Z == minPoint.Z && vertex.Y < minPoint.Y) { minPoint = vertex; }
-				else if (vertex.Z == minPoint.Z && vertex.Y == minPoint.Y && vertex.X < minPoint.X) { minPoint = vertex; }
-			}
-
-			FCartesianInPolar minPolarVertex;
-
-			//Find the polar coordinates from this vertex
-			TArray<FCartesianInPolar> polarVertices;
-			for (FVector vertex : coverVertices) {
-				FCartesianInPolar polarVertex = FCartesianInPolar(vertex, minPoint, getNormal(), absoluteMin);
-				if (vertex == minPoint) { minPolarVertex = polarVertex; }
-				else { polarVertices.Add(polarVertex); }
-			}
-
-			//Sort the polar coordinates
-			polarVertices.Sort(FSortByAngle());
-			stack.Push(minPolarVertex);
-
-			//Find the convex hull, which will be in the stack
-			for (FCartesianInPolar polarVertex : polarVertices) {
-				while (stack.Num() > 1 && isCounterClockWise(stack[stack.Num() - 2].relative, stack[stack.Num() - 1].relative, polarVertex.relative)) { stack.Pop(); }
-				stack.Push(polarVertex);
-			}
-
-			//Turns the 3D vertices into 2D based on the normal of the surface
-			TArray<FVector2D> flatVertices;
 
-			//Convert the 3D cartesian coordinates to 2D
-			for (FCartesianInPolar polarVertex : stack) {
-				if (getNormal().X != 0) { flatVertices.Add(FVector2D(polarVertex.relativeMin.Y, polarVertex.relativeMin.Z)); }
-				else if (getNormal().Y != 0) { flatVertices.Add(FVector2D(polarVertex.relativeMin.Z, polarVertex.relativeMin.X)); }
-				else if (getNormal().Z != 0) { flatVertices.Add(FVector2D(polarVertex.relativeMin.X, polarVertex.relativeMin.Y)); }
-			}
-
-			//If the convex area is somehow larger, then this is a bug. Ensure that the maximum is the size of the area
-			float area = calculateConvexArea(flatVertices);
-			if (weights.IsValidIndex(c)) {
-				if (area - weights[c] * totalSize > 0.5f) {
-					UE_LOG(LogTemp, Log, TEXT("Convex area is larger than the total area: cube %s of surface %s. Convex Area: %f; totalArea: %f"), *cube->GetName(), *this->GetName(), area, weights[c] * totalSize);
-					area = weights[c] * totalSize;
-				}
-			}
-
-			if (getNormal().X != 0) {
-				for (int32 i = 0; i < flatVertices.Num(); i++) {
-					FVector v1Loc = FVector(GetActorLocation().X, flatVertices[i].X, flatVertices[i].Y);
-					FVector v2Loc = FVector(GetActorLocation().X, flatVertices[(i+1)%flatVertices.Num()].X, flatVertices[(i + 1) % flatVertices.Num()].Y);
-
-					DrawDebugLine(GetWorld(), v1Loc, v2Loc, FColor::Purple, false, 60, 0, 5);
-				}
-			}
-			else if (getNormal().Y != 0) {
-				for (int32 i = 0; i < flatVertices.Num(); i++) {
-					FVector v1Loc = FVector(flatVertices[i].Y, GetActorLocation().Y, flatVertices[i].X);
-					FVector v2Loc = FVector(flatVertices[(i + 1) % flatVertices.Num()].Y, GetActorLocation().Y, flatVertices[(i + 1) % flatVertices.Num()].X);
+	cubeTable.build(weights);
+}
 
-					DrawDebugLine(GetWorld(), v1Loc, v2Loc, FColor::Purple, false, 60, 0, 5);
-				}
-			}
-			else if (getNormal().Z != 0) {
-				for (int32 i = 0; i < flatVertices.Num(); i++) {
-					FVector v1Loc = FVector(flatVertices[i].X, flatVertices[i].Y, GetActorLocation().Z);
-					FVector v2Loc = FVector(flatVertices[(i + 1) % flatVertices.Num()].X, flatVertices[(i + 1) % flatVertices.Num()].Y, GetActorLocation().Z);
+float ASurfaceArea::calculateCoverSize(float agentSize, float cellSize, const TArray<APRMEdge*>& surfaceEdges) {
+	//Rasterize the footprint of every edge of this surface type. Edges outside the surface do not touch the raster
+	resetCoverage(cellSize);
 
-					DrawDebugLine(GetWorld(), v1Loc, v2Loc, FColor::Purple, false, 60, 0, 5);
-				}
-			}
+	//The raster is flat, so edges of the same type on other storeys or in other rooms are left out by the extent of the cubes along the normal
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { totalCoverSize = 0; return totalCoverSize; }
+	int32 axisN = 3 - axisU - axisV;
+	TArray<FVector2D> depths;
+	for (UStaticMeshComponent* cube : cubes) {
+		if (!cube) { continue; }
+		float location = cube->GetComponentLocation()[axisN];
+		float halfSize = 50 * cube->GetComponentScale()[axisN];
+		depths.Add(FVector2D(location - halfSize, location + halfSize));
+	}
 
-			//Add the convex area to the total cover size
-			totalCoverSize += area;
-		}
+	for (APRMEdge* edge : surfaceEdges) {
+		if (!edge || !edge->spline || edge->surface != surface) { continue; }
+		FVector start = edge->GetActorLocation();
+		FVector end = start + edge->spline->GetEndPosition();
+
+		//Skip the edge if its span along the normal lies outside every cube
+		float minDepth = FMath::Min(start[axisN], end[axisN]);
+		float maxDepth = FMath::Max(start[axisN], end[axisN]);
+		bool inDepth = false;
+		for (const FVector2D& depth : depths) { if (minDepth <= depth.Y && maxDepth >= depth.X) { inDepth = true; break; } }
+		if (inDepth) { addEdgeCoverage(start, end, agentSize); }
 	}
+
+	totalCoverSize = coverage.coveredArea();
 	return totalCoverSize;
 }
 
@@ -682,6 +555,7 @@ void ASurfaceArea::computeMedialAxis()
 {
 	computePolygon();
 	straightSkeleton = findSkeleton();
+	buildSkeletonTable();
 	//baseDelaunay = computeDelaunayTriangulation();
 	//addSteinerPoints();
 	//finalTriangulation = medaxifyDelaunay();
@@ -1367,16 +1241,14 @@ AVertex* ASurfaceArea::generateVertex(int32 vertexID, float agentSize, bool show
 	//Vertex that will inevitably be placed
 	AVertex* returnValue;
 
-	//Random cube to place a vertex in
-	UStaticMeshComponent* selectedCube = getRandomCube();
+	//Cube to place a vertex in and the location in it to spawn the vertex
+	FVector spawnLocation;
+	UStaticMeshComponent* selectedCube = freeSpace ? getFreeSpaceLocation(spawnLocation) : getSampleLocation(spawnLocation);
 
 	//If a cube has been selected, continue
 	if (selectedCube) {
-		//Find the location to spawn a vertex
-		FVector spawnLocation = getRandomSpawnLocation(selectedCube);
-
-		//Handle obstacles
-		if (!isInObstacle(spawnLocation, agentSize) && !isInOtherSurface(spawnLocation)) {
+		//Handle obstacles. Locations in the free space are already clear of obstacles and other surfaces
+		if (freeSpace || (!isInObstacle(spawnLocation, agentSize) && !isInOtherSurface(spawnLocation))) {
 			//Now create the vertex. Handle the rest of the vertex creation later
 			returnValue = GetWorld()->SpawnActor<AVertex>(spawnLocation, FRotator(0), FActorSpawnParameters());
 			returnValue->id = vertexID;
@@ -1395,6 +1267,27 @@ AVertex* ASurfaceArea::generateVertex(int32 vertexID, float agentSize, bool show
 	return nullptr;
 }
 
+AVertex* ASurfaceArea::generateBiasedVertex(int32 vertexID, float agentSize, bool showVertex) {
+	//Vertex that will inevitably be placed
+	AVertex* returnValue = nullptr;
+
+	//Sample near a transition half of the time if this surface has neighbours, else look for a narrow passage
+	FVector spawnLocation;
+	UStaticMeshComponent* selectedCube = (neighbours.Num() > 0 && random.frand() < 0.5f) ? getTransitionLocation(spawnLocation) : getBridgeLocation(agentSize, spawnLocation);
+
+	if (selectedCube && isFreeLocation(spawnLocation, agentSize)) {
+		//Now create the vertex. Handle the rest of the vertex creation later
+		returnValue = GetWorld()->SpawnActor<AVertex>(spawnLocation, FRotator(0), FActorSpawnParameters());
+		returnValue->id = vertexID;
+		returnValue->surface = this->surface;
+
+		if (showVertex) { returnValue->showVertex(); }
+		else { returnValue->hideVertex(); }
+	}
+
+	return returnValue;
+}
+
 AVertex * ASurfaceArea::generateVertexInSubsurface(int32 vertexID, float agentSize, int32 subsurfaceIndex, bool showVertex)
 {
 	//Vertex that will inevitably be placed
@@ -1449,7 +1342,7 @@ AVertex * ASurfaceArea::generateVertexInRange(int32 vertexID, float agentSize, F
 	AVertex* returnValue;
 
 	//Get a random location between tne and bsw
-	FVector location = FVector(FMath::FRandRange(bsw.X, tne.X), FMath::FRandRange(bsw.Y, tne.Y), FMath::FRandRange(bsw.Z, tne.Z));
+	FVector location = FVector(random.frandRange(bsw.X, tne.X), random.frandRange(bsw.Y, tne.Y), random.frandRange(bsw.Z, tne.Z));
 	switch (surface) {
 	case ESurfaceType::Floor:
 		location.Z = (tne.Z + bsw.Z) / 2;
@@ -1524,93 +1417,107 @@ AHelperVertex* ASurfaceArea::generateHelperVertex(int32 vertexID, FVector locati
 
 UStaticMeshComponent * ASurfaceArea::getRandomCube()
 {
-	//The cube that a vertex will be generating in
-	UStaticMeshComponent* returnValue = nullptr;
+	//The table is not saved with the level, so build it again if it does not match the weights
+	if (cubeTable.num() != weights.Num()) { cubeTable.build(weights); }
 
-	//Find a random number between 0 and 1
-	float random = FMath::FRandRange(0, 1);
+	//Draw a cube with a chance equal to its weight
+	int32 index = cubeTable.sample(random);
+	return cubes.IsValidIndex(index) ? cubes[index] : nullptr;
+}
 
-	//Create an array with the sum of the weights per cube, so cube A has weight a, B has a + b, etc. Last cube has a + b + ... = 1.
-	TArray<float> sumOfWeights;
+void ASurfaceArea::buildSkeletonTable()
+{
+	TArray<float> lengths;
+	lengths.Reserve(straightSkeleton.Num());
+	for (const FPolygonEdge3D& edge : straightSkeleton) { lengths.Add((edge.vA - edge.vB).Size()); }
+	skeletonTable.build(lengths);
+}
 
-	for (int i = 0; i < weights.Num(); i++) {
-		float sumWeight = weights[i];
+FVector ASurfaceArea::getRandomSpawnLocation(UStaticMeshComponent* cube) {
+	//Draw the first value before the second, so the order of the stream stays the same for every surface type
+	float u = random.frand();
+	float v = random.frand();
+	return getSpawnLocationInCube(cube, u, v);
+}
 
-		//Except for the first item, add the weight of the previous sum
-		if (i > 0) { sumWeight += sumOfWeights[i - 1]; }
-		sumOfWeights.Add(sumWeight);
+UStaticMeshComponent* ASurfaceArea::getSampleLocation(FVector& outLocation) {
+	if (!lowDiscrepancy) {
+		UStaticMeshComponent* selectedCube = getRandomCube();
+		if (selectedCube) { outLocation = getRandomSpawnLocation(selectedCube); }
+		return selectedCube;
 	}
 
-	//Then select the lowest index j such that random <= weight at j
-	for (int j = 0; j < sumOfWeights.Num(); j++) {
-		if (random <= sumOfWeights[j]) {
-			returnValue = cubes[j];
-			break;
-		}
-	}
+	if (cubeTable.num() != weights.Num()) { cubeTable.build(weights); }
+	FVector2D point = halton.next();
 
-	return returnValue;
+	//Select the cube with the first coordinate, then use the part of the coordinate left over within that cube as the first axis
+	float u;
+	int32 index = cubeTable.sample(point.X, u);
+	if (!cubes.IsValidIndex(index)) { return nullptr; }
+
+	outLocation = getSpawnLocationInCube(cubes[index], u, point.Y);
+	return cubes[index];
 }
 
-FVector ASurfaceArea::getRandomSpawnLocation(UStaticMeshComponent* cube) {
+FVector ASurfaceArea::getSpawnLocationInCube(UStaticMeshComponent* cube, float u, float v) {
 	FVector returnValue = cube->GetComponentLocation();
 	float rx;
 	float ry;
 	float rz;
 
 	switch (surface) {
-	case ESurfaceType::Floor: //Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::Floor: //Find X and Y values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 		
-	case ESurfaceType::Ceiling://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::Ceiling://Find X and Y values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 		
-	case ESurfaceType::NorthWall://Find random Z and Y values in range of the cube to add to the component location
-		rz = FMath::FRandRange(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::NorthWall://Find Z and Y values in range of the cube to add to the component location
+		rz = FMath::Lerp(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.Z += rz;
 		returnValue.Y += ry;
 		return returnValue;
 		
-	case ESurfaceType::SouthWall://Find random Z and Y values in range of the cube to add to the component location
-		rz = FMath::FRandRange(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::SouthWall://Find Z and Y values in range of the cube to add to the component location
+		rz = FMath::Lerp(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.Z += rz;
 		returnValue.Y += ry;
 		return returnValue;
 		
-	case ESurfaceType::EastWall://Find random X and Z values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		rz = FMath::FRandRange(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9);
+	case ESurfaceType::EastWall://Find X and Z values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		rz = FMath::Lerp(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9, v);
 		returnValue.X += rx;
 		returnValue.Z += rz;
 		return returnValue;
 		
-	case ESurfaceType::WestWall://Find random X and Z values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		rz = FMath::FRandRange(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9);
+	case ESurfaceType::WestWall://Find X and Z values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		rz = FMath::Lerp(-50 * cube->GetComponentScale().Z + 9, 50 * cube->GetComponentScale().Z - 9, v);
 		returnValue.X += rx;
 		returnValue.Z += rz;
 		return returnValue;
 		
-	case ESurfaceType::Stairs://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::Stairs://Find X and Y values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 		
-	case ESurfaceType::StairsCeiling://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9);
-		ry = FMath::FRandRange(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9);
+	case ESurfaceType::StairsCeiling://Find X and Y values in range of the cube to add to the component location
+		rx = FMath::Lerp(-50 * cube->GetComponentScale().X + 9, 50 * cube->GetComponentScale().X - 9, u);
+		ry = FMath::Lerp(-50 * cube->GetComponentScale().Y + 9, 50 * cube->GetComponentScale().Y - 9, v);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
@@ -1620,35 +1527,335 @@ FVector ASurfaceArea::getRandomSpawnLocation(UStaticMeshComponent* cube) {
 	}
 }
 
-FVector ASurfaceArea::getRandomSkeletonLocation()
+bool ASurfaceArea::getPlaneAxes(int32& outAxisU, int32& outAxisV)
 {
-	//The cube that a vertex will be generating in
-	FVector returnValue = FVector();
+	switch (surface) {
+	case ESurfaceType::Floor:
+	case ESurfaceType::Ceiling:
+	case ESurfaceType::Stairs:
+	case ESurfaceType::StairsCeiling:
+		outAxisU = 0;
+		outAxisV = 1;
+		return true;
+	case ESurfaceType::NorthWall:
+	case ESurfaceType::SouthWall:
+		outAxisU = 2;
+		outAxisV = 1;
+		return true;
+	case ESurfaceType::EastWall:
+	case ESurfaceType::WestWall:
+		outAxisU = 0;
+		outAxisV = 2;
+		return true;
+	default:
+		return false;
+	}
+}
 
-	//Find a random number between 0 and 1
-	float random = FMath::FRandRange(0, 1);
-	float random2 = FMath::FRandRange(0, 1);
+bool ASurfaceArea::getCubeRectangle(UStaticMeshComponent* cube, int32 axisU, int32 axisV, float margin, FBox2D& outRectangle)
+{
+	if (!cube) { return false; }
 
-	//Create an array with the sum of the weights per cube, so cube A has weight a, B has a + b, etc. Last cube has a + b + ... = 1.
-	TArray<float> sumOfWeights;
+	FVector location = cube->GetComponentLocation();
+	FVector scale = cube->GetComponentScale();
+	FVector2D center(location[axisU], location[axisV]);
+	FVector2D halfSize(50 * scale[axisU] - margin, 50 * scale[axisV] - margin);
+	if (halfSize.X <= 0 || halfSize.Y <= 0) { return false; }
 
-	for (int i = 0; i < straightSkeleton.Num(); i++) {
-		float sumWeight = (straightSkeleton[i].vA - straightSkeleton[i].vB).Size() / skeletonSize;
+	outRectangle = FBox2D(center - halfSize, center + halfSize);
+	return true;
+}
 
-		//Except for the first item, add the weight of the previous sum
-		if (i > 0) { sumWeight += sumOfWeights[i - 1]; }
-		sumOfWeights.Add(sumWeight);
+void ASurfaceArea::buildFreeSpace(const TArray<FBox>& obstacles, const TArray<FBox>& otherSurfaces, float agentSize)
+{
+	freeRectangles.Empty();
+	freeSpaceTable.reset();
+
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { return; }
+	int32 axisN = 3 - axisU - axisV;
+
+	for (int32 i = 0; i < cubes.Num(); i++) {
+		TArray<FBox2D> pieces;
+		FBox2D rectangle;
+		if (!getCubeRectangle(cubes[i], axisU, axisV, 9, rectangle)) { continue; }
+		pieces.Add(rectangle);
+
+		//Same boxes as isInObstacle and isInOtherSurface: the agent size along the surface and 1 out of it for obstacles and room walls, 5 in every direction for surfaces
+		float height = cubes[i]->GetComponentLocation()[axisN];
+		for (const FBox& box : obstacles) { subtractFootprint(pieces, box, axisU, axisV, axisN, height, agentSize, 1); }
+		for (const FBox& box : otherSurfaces) { subtractFootprint(pieces, box, axisU, axisV, axisN, height, 5, 5); }
+
+		for (const FBox2D& piece : pieces) { freeRectangles.Add(FFreeRectangle(piece, i)); }
 	}
 
-	//Then select the lowest index j such that random <= weight at j
-	for (int j = 0; j < sumOfWeights.Num(); j++) {
-		if (random <= sumOfWeights[j]) {
-			returnValue = (1 - random2) * straightSkeleton[j].vA + random2 * straightSkeleton[j].vB;
-			break;
+	TArray<float> areas;
+	areas.Reserve(freeRectangles.Num());
+	for (const FFreeRectangle& free : freeRectangles) { areas.Add(free.rectangle.GetArea()); }
+	freeSpaceTable.build(areas);
+}
+
+UStaticMeshComponent* ASurfaceArea::getFreeSpaceLocation(FVector& outLocation)
+{
+	int32 index = freeSpaceTable.sample(random);
+	if (index == INDEX_NONE) { return nullptr; }
+
+	int32 axisU;
+	int32 axisV;
+	FBox2D cubeRectangle;
+	const FFreeRectangle& free = freeRectangles[index];
+	UStaticMeshComponent* cube = cubes[free.cube];
+	if (!getPlaneAxes(axisU, axisV) || !getCubeRectangle(cube, axisU, axisV, 9, cubeRectangle)) { return nullptr; }
+
+	//Draw a point in the free rectangle and express it relative to the whole cube
+	FVector2D point = FMath::Lerp(free.rectangle.Min, free.rectangle.Max, FVector2D(random.frand(), random.frand()));
+	FVector2D relative = (point - cubeRectangle.Min) / cubeRectangle.GetSize();
+	outLocation = getSpawnLocationInCube(cube, relative.X, relative.Y);
+	return cube;
+}
+
+UStaticMeshComponent* ASurfaceArea::getLocationFromPlane(FVector2D point, FVector& outLocation)
+{
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { return nullptr; }
+
+	for (UStaticMeshComponent* cube : cubes) {
+		FBox2D rectangle;
+		if (!getCubeRectangle(cube, axisU, axisV, 9, rectangle) || !rectangle.IsInside(point)) { continue; }
+
+		FVector2D relative = (point - rectangle.Min) / rectangle.GetSize();
+		outLocation = getSpawnLocationInCube(cube, relative.X, relative.Y);
+		return cube;
+	}
+
+	return nullptr;
+}
+
+bool ASurfaceArea::isFreeLocation(FVector location, float agentSize)
+{
+	if (!freeSpace) { return !isInObstacle(location, agentSize) && !isInOtherSurface(location); }
+
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { return false; }
+
+	FVector2D point(location[axisU], location[axisV]);
+	for (const FFreeRectangle& free : freeRectangles) { if (free.rectangle.IsInside(point)) { return true; } }
+	return false;
+}
+
+UStaticMeshComponent* ASurfaceArea::getBridgeLocation(float agentSize, FVector& outLocation)
+{
+	int32 axisU;
+	int32 axisV;
+	UStaticMeshComponent* firstCube = getRandomCube();
+	if (!firstCube || !getPlaneAxes(axisU, axisV)) { return nullptr; }
+
+	//The first end of the bridge has to be blocked
+	FVector first = getRandomSpawnLocation(firstCube);
+	if (isFreeLocation(first, agentSize)) { return nullptr; }
+
+	//The second end lies at a Gaussian distance in a random direction (Box-Muller). It has to lie on the surface and be blocked as well
+	float distance = 2 * agentSize * FMath::Sqrt(-2 * FMath::Loge(FMath::Max(1 - random.frand(), SMALL_NUMBER)));
+	float angle = 2 * PI * random.frand();
+	FVector2D firstPoint(first[axisU], first[axisV]);
+	FVector2D secondPoint = firstPoint + distance * FVector2D(FMath::Cos(angle), FMath::Sin(angle));
+	FVector second;
+	if (!getLocationFromPlane(secondPoint, second) || isFreeLocation(second, agentSize)) { return nullptr; }
+
+	return getLocationFromPlane((firstPoint + secondPoint) / 2, outLocation);
+}
+
+UStaticMeshComponent* ASurfaceArea::getTransitionLocation(FVector& outLocation)
+{
+	int32 axisU;
+	int32 axisV;
+	if (neighbours.Num() < 1 || cubes.Num() < 1 || !getPlaneAxes(axisU, axisV)) { return nullptr; }
+
+	//Overlap box of a random neighbour in the plane of the surface
+	const FSurfaceNeighbour& neighbour = neighbours[FMath::Min((int32)(random.frand() * neighbours.Num()), neighbours.Num() - 1)];
+	FVector boxMin = neighbour.tne.ComponentMin(neighbour.bsw);
+	FVector boxMax = neighbour.tne.ComponentMax(neighbour.bsw);
+	FBox2D box(FVector2D(boxMin[axisU], boxMin[axisV]), FVector2D(boxMax[axisU], boxMax[axisV]));
+
+	//Use the first cube that overlaps the box, starting at a random cube so every overlapping cube can be used
+	int32 firstCube = FMath::Min((int32)(random.frand() * cubes.Num()), cubes.Num() - 1);
+	for (int32 c = 0; c < cubes.Num(); c++) {
+		UStaticMeshComponent* cube = cubes[(firstCube + c) % cubes.Num()];
+		FBox2D rectangle;
+		if (!getCubeRectangle(cube, axisU, axisV, 9, rectangle)) { continue; }
+
+		FVector2D overlapMin(FMath::Max(rectangle.Min.X, box.Min.X), FMath::Max(rectangle.Min.Y, box.Min.Y));
+		FVector2D overlapMax(FMath::Min(rectangle.Max.X, box.Max.X), FMath::Min(rectangle.Max.Y, box.Max.Y));
+		if (overlapMin.X > overlapMax.X || overlapMin.Y > overlapMax.Y) { continue; }
+
+		//Draw a point in the overlap and express it relative to the whole cube
+		FVector2D point = FMath::Lerp(overlapMin, overlapMax, FVector2D(random.frand(), random.frand()));
+		FVector2D relative = (point - rectangle.Min) / rectangle.GetSize();
+		outLocation = getSpawnLocationInCube(cube, relative.X, relative.Y);
+		return cube;
+	}
+
+	return nullptr;
+}
+
+void ASurfaceArea::resetCoverage(float cellSize)
+{
+	coverage.reset();
+
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { return; }
+
+	//The whole cubes, without the spawn margin, so the covered area is measured against the same area as the edges are drawn on
+	TArray<FBox2D> rectangles;
+	FBox2D bounds(ForceInit);
+	for (UStaticMeshComponent* cube : cubes) {
+		FBox2D rectangle;
+		if (!getCubeRectangle(cube, axisU, axisV, 0, rectangle)) { continue; }
+		rectangles.Add(rectangle);
+		bounds += rectangle;
+	}
+
+	coverage.init(bounds, FMath::Max(cellSize, 1.f));
+	for (const FBox2D& rectangle : rectangles) { coverage.addArea(rectangle); }
+}
+
+void ASurfaceArea::addEdgeCoverage(FVector start, FVector end, float agentSize)
+{
+	int32 axisU;
+	int32 axisV;
+	if (!getPlaneAxes(axisU, axisV)) { return; }
+
+	coverage.addCapsule(FVector2D(start[axisU], start[axisV]), FVector2D(end[axisU], end[axisV]), agentSize);
+}
+
+void ASurfaceArea::findPoissonLocations(float minimumSpacing, int32 maxCount, TArray<FVector>& outLocations)
+{
+	int32 axisU;
+	int32 axisV;
+	if (maxCount <= 0 || !getPlaneAxes(axisU, axisV)) { return; }
+
+	//Rectangles of the cubes in the plane of the surface, with the same margin as getSpawnLocationInCube
+	TArray<FBox2D> rectangles;
+	TArray<UStaticMeshComponent*> rectangleCubes;
+	FBox2D bounds(ForceInit);
+	float area = 0;
+	for (UStaticMeshComponent* cube : cubes) {
+		FBox2D rectangle;
+		if (!getCubeRectangle(cube, axisU, axisV, 9, rectangle)) { continue; }
+
+		rectangles.Add(rectangle);
+		rectangleCubes.Add(cube);
+		bounds += rectangle;
+		area += rectangle.GetArea();
+	}
+	if (rectangles.Num() == 0) { return; }
+
+	//A filled Poisson-disk set with spacing r holds about 0.7 * area / r^2 points
+	float spacing = FMath::Max(minimumSpacing, FMath::Sqrt(0.7f * area / maxCount));
+	if (spacing <= 0) { return; }
+
+	//Background grid with cells of spacing / sqrt(2), so every cell holds at most one point
+	float cellSize = spacing / FMath::Sqrt(2.f);
+	FVector2D boundsSize = bounds.GetSize();
+	int32 columns = FMath::Max(1, FMath::CeilToInt(boundsSize.X / cellSize));
+	int32 rows = FMath::Max(1, FMath::CeilToInt(boundsSize.Y / cellSize));
+
+	//Too many cells means the spacing is tiny compared to the surface, which maxCount would cut off long before the grid fills. Widen the spacing until the grid fits
+	if ((int64)columns * rows > MaxPoissonCells) {
+		float requestedSpacing = spacing;
+		while ((int64)columns * rows > MaxPoissonCells) {
+			spacing *= FMath::Max(1.01f, FMath::Sqrt((float)((double)columns * rows / MaxPoissonCells)));
+			cellSize = spacing / FMath::Sqrt(2.f);
+			columns = FMath::Max(1, FMath::CeilToInt(boundsSize.X / cellSize));
+			rows = FMath::Max(1, FMath::CeilToInt(boundsSize.Y / cellSize));
 		}
+		UE_LOG(LogTemp, Log, TEXT("Poisson-disk grid of %s is too large, spacing widened from %f to %f."), *GetName(), requestedSpacing, spacing);
 	}
 
-	return returnValue;
+	TArray<int32> grid;
+	grid.Init(INDEX_NONE, columns * rows);
+	TArray<FVector2D> points;
+	TArray<int32> pointCubes;
+	TArray<int32> active;
+
+	//Checks if a point lies on the surface and is far enough from all points so far. Returns the rectangle it is in or INDEX_NONE
+	auto findRectangle = [&](const FVector2D& point) {
+		int32 rectangle = INDEX_NONE;
+		for (int32 i = 0; i < rectangles.Num(); i++) { if (rectangles[i].IsInside(point)) { rectangle = i; break; } }
+		if (rectangle == INDEX_NONE) { return rectangle; }
+
+		int32 column = FMath::Clamp(FMath::FloorToInt((point.X - bounds.Min.X) / cellSize), 0, columns - 1);
+		int32 row = FMath::Clamp(FMath::FloorToInt((point.Y - bounds.Min.Y) / cellSize), 0, rows - 1);
+		for (int32 y = FMath::Max(0, row - 2); y <= FMath::Min(rows - 1, row + 2); y++) {
+			for (int32 x = FMath::Max(0, column - 2); x <= FMath::Min(columns - 1, column + 2); x++) {
+				int32 other = grid[y * columns + x];
+				if (other != INDEX_NONE && FVector2D::DistSquared(points[other], point) < spacing * spacing) { return (int32)INDEX_NONE; }
+			}
+		}
+		return rectangle;
+	};
+
+	auto addPoint = [&](const FVector2D& point, int32 rectangle) {
+		int32 column = FMath::Clamp(FMath::FloorToInt((point.X - bounds.Min.X) / cellSize), 0, columns - 1);
+		int32 row = FMath::Clamp(FMath::FloorToInt((point.Y - bounds.Min.Y) / cellSize), 0, rows - 1);
+		grid[row * columns + column] = points.Add(point);
+		pointCubes.Add(rectangle);
+		active.Add(points.Num() - 1);
+	};
+
+	//Start a new front in every rectangle that is still empty, so cubes that do not touch are covered as well
+	for (int32 seed = 0; seed < rectangles.Num() && points.Num() < maxCount; seed++) {
+		FVector2D start = FMath::Lerp(rectangles[seed].Min, rectangles[seed].Max, FVector2D(random.frand(), random.frand()));
+		int32 startRectangle = findRectangle(start);
+		if (startRectangle == INDEX_NONE) { continue; }
+		addPoint(start, startRectangle);
+
+		while (active.Num() > 0 && points.Num() < maxCount) {
+			int32 activeIndex = random.next() % active.Num();
+			FVector2D base = points[active[activeIndex]];
+
+			//Try a fixed amount of candidates in the ring between spacing and twice the spacing around the base
+			bool found = false;
+			for (int32 k = 0; k < 30 && !found; k++) {
+				float angle = random.frand() * 2 * PI;
+				float distance = spacing * (1 + random.frand());
+				FVector2D candidate = base + distance * FVector2D(FMath::Cos(angle), FMath::Sin(angle));
+
+				int32 rectangle = findRectangle(candidate);
+				if (rectangle != INDEX_NONE) {
+					addPoint(candidate, rectangle);
+					found = true;
+				}
+			}
+
+			//The base is surrounded, so it will not get new neighbours
+			if (!found) { active.RemoveAtSwap(activeIndex); }
+		}
+	}
+
+	//Turn the points back into locations on the cubes they lie in
+	outLocations.Reserve(outLocations.Num() + points.Num());
+	for (int32 i = 0; i < points.Num(); i++) {
+		const FBox2D& rectangle = rectangles[pointCubes[i]];
+		FVector2D relative = (points[i] - rectangle.Min) / rectangle.GetSize();
+		outLocations.Add(getSpawnLocationInCube(rectangleCubes[pointCubes[i]], relative.X, relative.Y));
+	}
+}
+
+FVector ASurfaceArea::getRandomSkeletonLocation()
+{
+	if (skeletonTable.num() != straightSkeleton.Num()) { buildSkeletonTable(); }
+
+	//Draw a segment with a chance equal to its share of the length of the skeleton, then a random point on it
+	int32 index = skeletonTable.sample(random);
+	if (!straightSkeleton.IsValidIndex(index)) { return FVector(); }
+
+	float t = random.frand();
+	return (1 - t) * straightSkeleton[index].vA + t * straightSkeleton[index].vB;
 }
 
 FVector ASurfaceArea::getRandomSpawnLocationInBox(UStaticMeshComponent* cube, FVector tne, FVector bsw) {
@@ -1659,57 +1866,57 @@ FVector ASurfaceArea::getRandomSpawnLocationInBox(UStaticMeshComponent* cube, FV
 
 	switch (surface) {
 	case ESurfaceType::Floor: //Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 
 	case ESurfaceType::Ceiling://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 
 	case ESurfaceType::NorthWall://Find random Z and Y values in range of the cube to add to the component location
-		rz = FMath::FRandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rz = random.frandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.Z += rz;
 		returnValue.Y += ry;
 		return returnValue;
 
 	case ESurfaceType::SouthWall://Find random Z and Y values in range of the cube to add to the component location
-		rz = FMath::FRandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rz = random.frandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.Z += rz;
 		returnValue.Y += ry;
 		return returnValue;
 
 	case ESurfaceType::EastWall://Find random X and Z values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		rz = FMath::FRandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		rz = random.frandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
 		returnValue.X += rx;
 		returnValue.Z += rz;
 		return returnValue;
 
 	case ESurfaceType::WestWall://Find random X and Z values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		rz = FMath::FRandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		rz = random.frandRange(-49 * cube->GetComponentScale().Z, 49 * cube->GetComponentScale().Z);
 		returnValue.X += rx;
 		returnValue.Z += rz;
 		return returnValue;
 
 	case ESurfaceType::Stairs://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
 
 	case ESurfaceType::StairsCeiling://Find random X and Y values in range of the cube to add to the component location
-		rx = FMath::FRandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
-		ry = FMath::FRandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
+		rx = random.frandRange(-49 * cube->GetComponentScale().X, 49 * cube->GetComponentScale().X);
+		ry = random.frandRange(-49 * cube->GetComponentScale().Y, 49 * cube->GetComponentScale().Y);
 		returnValue.X += rx;
 		returnValue.Y += ry;
 		return returnValue;
@@ -2006,19 +2213,19 @@ void ASurfaceArea::computePolygon() {
 			//Now check if the edges are candidates for the polygon or whether they need to be adjusted
 			bool hasSplit = false;
 			//UE_LOG(LogTemp, Log, TEXT("Handle edge: %s to %s"), *fV1.ToString(), *fV3.ToString());
-			for (FPolygonEdge edge : tempEdges) { fixEdgeOverlap(edge, e13, candidateEdges, candidateEdges, hasSplit, hasSplit); }
+			for (const FPolygonEdge& edge : tempEdges) { fixEdgeOverlap(edge, e13, candidateEdges, hasSplit); }
 			if (!hasSplit) { candidateEdges.Add(e13); }
 			hasSplit = false;
 			//UE_LOG(LogTemp, Log, TEXT("Handle edge: %s to %s"), *fV1.ToString(), *fV4.ToString());
-			for (FPolygonEdge edge : tempEdges) { fixEdgeOverlap(edge, e14, candidateEdges, candidateEdges, hasSplit, hasSplit); }
+			for (const FPolygonEdge& edge : tempEdges) { fixEdgeOverlap(edge, e14, candidateEdges, hasSplit); }
 			if (!hasSplit) { candidateEdges.Add(e14); }
 			hasSplit = false;
 			//UE_LOG(LogTemp, Log, TEXT("Handle edge: %s to %s"), *fV2.ToString(), *fV3.ToString());
-			for (FPolygonEdge edge : tempEdges) { fixEdgeOverlap(edge, e23, candidateEdges, candidateEdges, hasSplit, hasSplit); }
+			for (const FPolygonEdge& edge : tempEdges) { fixEdgeOverlap(edge, e23, candidateEdges, hasSplit); }
 			if (!hasSplit) { candidateEdges.Add(e23); }
 			hasSplit = false;
 			//UE_LOG(LogTemp, Log, TEXT("Handle edge: %s to %s"), *fV2.ToString(), *fV4.ToString());
-			for (FPolygonEdge edge : tempEdges) { fixEdgeOverlap(edge, e24, candidateEdges, candidateEdges, hasSplit, hasSplit); }
+			for (const FPolygonEdge& edge : tempEdges) { fixEdgeOverlap(edge, e24, candidateEdges, hasSplit); }
 			if (!hasSplit) { candidateEdges.Add(e24); }
 		}
 	}
@@ -2173,57 +2380,55 @@ void ASurfaceArea::computePolygon() {
 		orderedVertices.AddUnique(vertex3D);
 	}
 
-	polygon = FSurfPolygon(orderedVertices2D, orderedVertices);
+	polygon = FSurfPolygon(MoveTemp(orderedVertices2D), MoveTemp(orderedVertices));
 }
 
-void ASurfaceArea::fixEdgeOverlap(FPolygonEdge oE, FPolygonEdge nE, TArray<FPolygonEdge> inEdges, TArray<FPolygonEdge>& outEdges, bool inHasSplit, bool &outHasSplit)
+void ASurfaceArea::fixEdgeOverlap(const FPolygonEdge& oE, const FPolygonEdge& nE, TArray<FPolygonEdge>& edges, bool &hasSplit)
 {
-	outEdges = inEdges;
-	outHasSplit = inHasSplit;
 	//Depending on the overlap case, remove the oE and add new edges.
 
 	//Case 1: old and new edge are the same. This is an interior edge and should be removed entirely
-	if ((oE.vA == nE.vA && oE.vB == nE.vB) || (oE.vA == nE.vB && oE.vB == nE.vA)) { outEdges.Remove(oE); outHasSplit = true; }
+	if ((oE.vA == nE.vA && oE.vB == nE.vB) || (oE.vA == nE.vB && oE.vB == nE.vA)) { edges.Remove(oE); hasSplit = true; }
 
 	//Case 2: new edge and old edge are parallel at the same X
 	else if (oE.vA.X == oE.vB.X && nE.vA.X == nE.vB.X && oE.vA.X == nE.vA.X) {
 		//UE_LOG(LogTemp, Log, TEXT("Case 2: Parallel X"));
-		outEdges.Remove(oE);
+		edges.Remove(oE);
 
 		//Case A: oA & nA | oB & nB \/ oB & nB | oA & nA
 		if ((oE.vA.Y < oE.vB.Y && oE.vA.Y < nE.vB.Y && nE.vA.Y < oE.vB.Y && nE.vA.Y < nE.vB.Y) || (oE.vA.Y > oE.vB.Y && oE.vA.Y > nE.vB.Y && nE.vA.Y > oE.vB.Y && nE.vA.Y > nE.vB.Y))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("X overlap case A: try to connect oA and nA"));
-			if (oE.vA.Y != nE.vA.Y) { outEdges.Add(FPolygonEdge(oE.vA, nE.vA, true)); outHasSplit = true; }
+			if (oE.vA.Y != nE.vA.Y) { edges.Add(FPolygonEdge(oE.vA, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAY and NAY are equal")); }
-			if (oE.vB.Y != nE.vB.Y) { outEdges.Add(FPolygonEdge(oE.vB, nE.vB, true)); outHasSplit = true; }
+			if (oE.vB.Y != nE.vB.Y) { edges.Add(FPolygonEdge(oE.vB, nE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OBY and NBY are equal")); }
 		}
 		//Case B: oA & nB | oB & nA \/ oB & nA | oA & nB
 		else if ((oE.vA.Y < oE.vB.Y && oE.vA.Y < nE.vA.Y && nE.vB.Y < oE.vB.Y && nE.vB.Y < nE.vA.Y) || (oE.vA.Y > oE.vB.Y && oE.vA.Y > nE.vA.Y && nE.vB.Y > oE.vB.Y && nE.vB.Y > nE.vA.Y))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("X overlap case B: try to connect oA and nB"));
-			if (oE.vA.Y != nE.vB.Y) { outEdges.Add(FPolygonEdge(oE.vA, nE.vB, true)); outHasSplit = true; }
+			if (oE.vA.Y != nE.vB.Y) { edges.Add(FPolygonEdge(oE.vA, nE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAY and NBY are equal")); }
-			if (oE.vB.Y != nE.vA.Y) { outEdges.Add(FPolygonEdge(oE.vB, nE.vA, true)); outHasSplit = true; }
+			if (oE.vB.Y != nE.vA.Y) { edges.Add(FPolygonEdge(oE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OBY and NAY are equal")); }
 		}
 		//Case C: oA & oB | nA & nB \/ nA & nB | oA & oB
 		else if ((oE.vA.Y < nE.vA.Y && oE.vA.Y < nE.vB.Y && oE.vB.Y < nE.vA.Y && oE.vB.Y < nE.vB.Y) || (oE.vA.Y > nE.vA.Y && oE.vA.Y > nE.vB.Y && oE.vB.Y > nE.vA.Y && oE.vB.Y > nE.vB.Y))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("X overlap case C: try to connect oA and oB"));
-			if (oE.vA.Y != oE.vB.Y) { outEdges.Add(FPolygonEdge(oE.vA, oE.vB, true)); outHasSplit = true; }
+			if (oE.vA.Y != oE.vB.Y) { edges.Add(FPolygonEdge(oE.vA, oE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAY and OBY are equal")); }
-			if (nE.vB.Y != nE.vA.Y) { outEdges.Add(FPolygonEdge(nE.vB, nE.vA, true)); outHasSplit = true; }
+			if (nE.vB.Y != nE.vA.Y) { edges.Add(FPolygonEdge(nE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("NAY and NBY are equal")); }
 		}
 
 		//Case D: Two of the vertices overlap, so the two edges either touch or are equal (handled by Case 1). If edges touch, they can be safely added
 		else {
 			//UE_LOG(LogTemp, Log, TEXT("X overlap case D: two overlapping vertices"));
-			if (oE.vA.Y != oE.vB.Y) { outEdges.Add(FPolygonEdge(oE.vA, oE.vB, true)); outHasSplit = true; }
+			if (oE.vA.Y != oE.vB.Y) { edges.Add(FPolygonEdge(oE.vA, oE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAY and OBY are equal")); }
-			if (nE.vB.Y != nE.vA.Y) { outEdges.Add(FPolygonEdge(nE.vB, nE.vA, true)); outHasSplit = true; }
+			if (nE.vB.Y != nE.vA.Y) { edges.Add(FPolygonEdge(nE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("NAY and NBY are equal")); }
 		}
 	}
@@ -2231,42 +2436,42 @@ void ASurfaceArea::fixEdgeOverlap(FPolygonEdge oE, FPolygonEdge nE, TArray<FPoly
 	//Case 3: new edge and old edge are parallel at the same Y
 	else if (oE.vA.Y == oE.vB.Y && nE.vA.Y == nE.vB.Y && oE.vA.Y == nE.vA.Y) {
 		//UE_LOG(LogTemp, Log, TEXT("Case 3: Parallel Y"));
-		outEdges.Remove(oE);
+		edges.Remove(oE);
 
 		//Case A: oA & nA | oB & nB \/ oB & nB | oA & nA
 		if ((oE.vA.X < oE.vB.X && oE.vA.X < nE.vB.X && nE.vA.X < oE.vB.X && nE.vA.X < nE.vB.X) || (oE.vA.X > oE.vB.X && oE.vA.X > nE.vB.X && nE.vA.X > oE.vB.X && nE.vA.X > nE.vB.X))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("Y overlap case A: try to connect oA and nA"));
-			if (oE.vA.X != nE.vA.X) { outEdges.Add(FPolygonEdge(oE.vA, nE.vA, true)); outHasSplit = true; }
+			if (oE.vA.X != nE.vA.X) { edges.Add(FPolygonEdge(oE.vA, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAX and NAX are equal")); }
-			if (oE.vB.X != nE.vB.X) { outEdges.Add(FPolygonEdge(oE.vB, nE.vB, true)); outHasSplit = true; }
+			if (oE.vB.X != nE.vB.X) { edges.Add(FPolygonEdge(oE.vB, nE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OBX and NBX are equal")); }
 		}
 		//Case B: oA & nB | oB & nA \/ oB & nA | oA & nB
 		else if ((oE.vA.X < oE.vB.X && oE.vA.X < nE.vA.X && nE.vB.X < oE.vB.X && nE.vB.X < nE.vA.X) || (oE.vA.X > oE.vB.X && oE.vA.X > nE.vA.X && nE.vB.X > oE.vB.X && nE.vB.X > nE.vA.X))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("Y overlap case B: try to connect oA and nB"));
-			if (oE.vA.X != nE.vB.X) { outEdges.Add(FPolygonEdge(oE.vA, nE.vB, true)); outHasSplit = true; }
+			if (oE.vA.X != nE.vB.X) { edges.Add(FPolygonEdge(oE.vA, nE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAX and NBX are equal")); }
-			if (oE.vB.X != nE.vA.X) { outEdges.Add(FPolygonEdge(oE.vB, nE.vA, true)); outHasSplit = true; }
+			if (oE.vB.X != nE.vA.X) { edges.Add(FPolygonEdge(oE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("NAX and OBX are equal")); }
 		}
 		//Case C: oA & oB | nA & nB \/ nA & nB | oA & oB
 		else if ((oE.vA.X < nE.vA.X && oE.vA.X < nE.vB.X && oE.vB.X < nE.vA.X && oE.vB.X < nE.vB.X) || (oE.vA.X > nE.vA.X && oE.vA.X > nE.vB.X && oE.vB.X > nE.vA.X && oE.vB.X > nE.vB.X))
 		{
 			//UE_LOG(LogTemp, Log, TEXT("Y overlap case C: try to connect oA and oB"));
-			if (oE.vA.X != oE.vB.X) { outEdges.Add(FPolygonEdge(oE.vA, oE.vB, true)); outHasSplit = true; }
+			if (oE.vA.X != oE.vB.X) { edges.Add(FPolygonEdge(oE.vA, oE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAX and OBX are equal")); }
-			if (nE.vB.X != nE.vA.X) { outEdges.Add(FPolygonEdge(nE.vB, nE.vA, true)); outHasSplit = true; }
+			if (nE.vB.X != nE.vA.X) { edges.Add(FPolygonEdge(nE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("NAX and NBX are equal")); }
 		}
 
 		//Case D: Two of the vertices overlap, so the two edges either touch or are equal (handled by Case 1). If edges touch, they can be safely added
 		else {
 			//UE_LOG(LogTemp, Log, TEXT("Y overlap case D: two overlapping vertices"));
-			if (oE.vA.X != oE.vB.X) { outEdges.Add(FPolygonEdge(oE.vA, oE.vB, true)); outHasSplit = true; }
+			if (oE.vA.X != oE.vB.X) { edges.Add(FPolygonEdge(oE.vA, oE.vB, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("OAX and OBX are equal")); }
-			if (nE.vB.X != nE.vA.X) { outEdges.Add(FPolygonEdge(nE.vB, nE.vA, true)); outHasSplit = true; }
+			if (nE.vB.X != nE.vA.X) { edges.Add(FPolygonEdge(nE.vB, nE.vA, true)); hasSplit = true; }
 			//else { UE_LOG(LogTemp, Log, TEXT("NAX and NBX are equal")); }
 		}
 	}
@@ -8,9 +8,24 @@
 #include "Utils.h"
 #include "Vertex.h"
 #include "HelperVertex.h"
+#include "PRMEdge.h"
 #include "CGALWrapperUtils.h"
+#include "BuildRandom.h"
+#include "CoverageRaster.h"
 #include "SurfaceArea.generated.h"
 
+//Part of a cube of a surface that has no obstacles or other surfaces in it
+struct FFreeRectangle
+{
+	FFreeRectangle(FBox2D inRectangle, int32 inCube);
+
+	//Free part in the plane of the surface
+	FBox2D rectangle;
+
+	//Index of the cube the rectangle was cut from
+	int32 cube;
+};
+
 UCLASS()
 class DPP3DS_API ASurfaceArea : public AActor
 {
@@ -67,6 +82,33 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "Polygon")
 		FMedialAxis medialAxis;
 
+	//Random stream of this surface, seeded by the collector from the build seed
+	FBuildRandom random;
+
+	//Table to draw a cube by its weight. Built by calculateWeights
+	FAliasTable cubeTable;
+
+	//Table to draw a segment of the straight skeleton by its length. Built by computeMedialAxis
+	FAliasTable skeletonTable;
+
+	//Halton sequence of this surface, offset by its random stream
+	FHaltonSequence halton;
+
+	//If true, vertices are placed with the Halton sequence instead of the random stream
+	bool lowDiscrepancy;
+
+	//Parts of the cubes without obstacles or other surfaces, found by buildFreeSpace
+	TArray<FFreeRectangle> freeRectangles;
+
+	//Table to draw a free rectangle by its area
+	FAliasTable freeSpaceTable;
+
+	//If true, vertices are placed in the free rectangles, so they do not have to be checked against obstacles
+	bool freeSpace;
+
+	//Part of the surface covered by edges. Used by the adaptive vertex budget and to calculate the cover size
+	FCoverageRaster coverage;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -110,9 +152,8 @@ public:
 	UFUNCTION(CallInEditor, Category = "Surface Area")
 		void calculateWeights();
 
-	//Calculates the size of the cover in this surface
-	UFUNCTION(CallInEditor, Category = "Build Stats")
-		float calculateCoverSize(float agentSize);
+	//Calculates the size of the cover in this surface by rasterizing the edges of its surface type into cells of the given size
+	float calculateCoverSize(float agentSize, float cellSize, const TArray<APRMEdge*>& surfaceEdges);
 
 	//Shows the surface area
 	UFUNCTION(CallInEditor, Category = "Rendering")
@@ -305,6 +346,9 @@ public:
 	//Generates a vertex with a given ID
 	AVertex* generateVertex(int32 vertexID, float agentSize, bool showVertex);
 
+	//Generates a vertex with a given ID near a narrow passage or in the overlap box of a neighbouring surface. Returns nullptr if the location found is not free
+	AVertex* generateBiasedVertex(int32 vertexID, float agentSize, bool showVertex);
+
 	//Generates a vertex with a given ID in a specific subsurface
 	AVertex* generateVertexInSubsurface(int32 vertexID, float agentSize, int32 subsurfaceIndex, bool showVertex);
 
@@ -320,9 +364,53 @@ public:
 	//Finds a random cube of this surface
 	UStaticMeshComponent* getRandomCube();
 
+	//Builds the table to draw segments of the straight skeleton by their length
+	void buildSkeletonTable();
+
 	//Defines the spawn location for a vertex depending on the given cube and the surface type.
 	FVector getRandomSpawnLocation(UStaticMeshComponent* cube);
 
+	//Defines the spawn location in the given cube from two values in [0, 1), one per axis of the surface
+	FVector getSpawnLocationInCube(UStaticMeshComponent* cube, float u, float v);
+
+	//Finds a cube and the location in it to spawn a vertex. Uses the Halton sequence if lowDiscrepancy is set, else the random stream
+	UStaticMeshComponent* getSampleLocation(FVector& outLocation);
+
+	//Finds the two axes of the plane of the surface, in the order getSpawnLocationInCube uses them. Returns false if the surface type has no plane
+	bool getPlaneAxes(int32& outAxisU, int32& outAxisV);
+
+	//Finds the rectangle of a cube in the plane of the surface, shrunk by the margin on every side. getSpawnLocationInCube uses a margin of 9. Returns false if nothing is left of the cube
+	bool getCubeRectangle(UStaticMeshComponent* cube, int32 axisU, int32 axisV, float margin, FBox2D& outRectangle);
+
+	//Cuts the cubes into rectangles that no obstacle (grown by the agent size) or other surface overlaps, and builds the table to draw them by area
+	void buildFreeSpace(const TArray<FBox>& obstacles, const TArray<FBox>& otherSurfaces, float agentSize);
+
+	//Finds a location in a free rectangle, drawn by area. Returns the cube of the location or nullptr if there is no free space
+	UStaticMeshComponent* getFreeSpaceLocation(FVector& outLocation);
+
+	//Finds the cube that contains a point in the plane of the surface and the spawn location of that point. Returns nullptr if no cube contains it
+	UStaticMeshComponent* getLocationFromPlane(FVector2D point, FVector& outLocation);
+
+	//Checks if a vertex can be placed at the location without hitting an obstacle or another surface. Uses the free rectangles if freeSpace is set
+	bool isFreeLocation(FVector location, float agentSize);
+
+	//Bridge test: finds a blocked location and a second location on the surface at a Gaussian distance from it. If that is blocked too, the midpoint is returned as it likely lies in a narrow passage.
+	//Returns nullptr if the test fails. The midpoint itself is not checked
+	UStaticMeshComponent* getBridgeLocation(float agentSize, FVector& outLocation);
+
+	//Finds a random location in the part of the overlap box of a random neighbouring surface that lies on this surface. Returns nullptr if there is none
+	UStaticMeshComponent* getTransitionLocation(FVector& outLocation);
+
+	//Sets up an empty coverage raster over the cubes with cells of the given size
+	void resetCoverage(float cellSize);
+
+	//Marks the part of the surface within the agent size of the edge from start to end as covered
+	void addEdgeCoverage(FVector start, FVector end, float agentSize);
+
+	//Finds up to maxCount spawn locations with Bridson's Poisson-disk sampling over the cubes of this surface.
+	//The spacing is widened from minimumSpacing so that a filled surface holds about maxCount locations
+	void findPoissonLocations(float minimumSpacing, int32 maxCount, TArray<FVector>& outLocations);
+
 	//Defines the spawn location on the exact medial axis.
 	FVector getRandomSkeletonLocation();
 
@@ -357,7 +445,7 @@ public:
 	void computePolygon();
 	
 	//Ensures that two polygon edges do not overlap. Can return a variety of options
-	void fixEdgeOverlap(FPolygonEdge oE, FPolygonEdge nE, TArray<FPolygonEdge> inEdges, TArray<FPolygonEdge> &outEdges, bool inHasSplit, bool &hasSplit);
+	void fixEdgeOverlap(const FPolygonEdge& oE, const FPolygonEdge& nE, TArray<FPolygonEdge> &edges, bool &hasSplit);
 
 	//Creates a Delaunay Triangulation of the polygon according to "Sweep-line algorithm for constrained Delaunay triangulation" by Domiter and Zalik
 	TArray<FDTriangle> computeDelaunayTriangulation();
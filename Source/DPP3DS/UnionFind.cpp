@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "UnionFind.h"
+
+FUnionFind::FUnionFind() {}
+
+void FUnionFind::init(int32 count)
+{
+	parents.SetNumUninitialized(FMath::Max(count, 0));
+	for (int32 i = 0; i < parents.Num(); i++) { parents[i] = i; }
+	ranks.Init(0, parents.Num());
+}
+
+void FUnionFind::grow(int32 count)
+{
+	for (int32 i = parents.Num(); i < count; i++) {
+		parents.Add(i);
+		ranks.Add(0);
+	}
+}
+
+int32 FUnionFind::find(int32 element)
+{
+	if (!parents.IsValidIndex(element)) { return element; }
+
+	//Path halving: every visited element skips to its grandparent
+	while (parents[element] != element) {
+		parents[element] = parents[parents[element]];
+		element = parents[element];
+	}
+	return element;
+}
+
+bool FUnionFind::merge(int32 a, int32 b)
+{
+	int32 rootA = find(a);
+	int32 rootB = find(b);
+	if (rootA == rootB || !parents.IsValidIndex(rootA) || !parents.IsValidIndex(rootB)) { return false; }
+
+	//Hang the lower tree under the higher one, so the trees stay flat
+	if (ranks[rootA] < ranks[rootB]) { Swap(rootA, rootB); }
+	parents[rootB] = rootA;
+	if (ranks[rootA] == ranks[rootB]) { ranks[rootA]++; }
+	return true;
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Disjoint sets over the elements 0 to n - 1. Used to keep track of which vertices are already connected while generating and connecting the PRMS
+ */
+
+class FUnionFind
+{
+public:
+	FUnionFind();
+
+	//Puts every element from 0 to count - 1 in its own set
+	void init(int32 count);
+
+	//Adds elements in their own set until there are count elements
+	void grow(int32 count);
+
+	//Finds the representative of the set of the element. Elements out of range are their own representative
+	int32 find(int32 element);
+
+	//Joins the sets of a and b. Returns false if they were already in the same set or one of them is out of range
+	bool merge(int32 a, int32 b);
+
+	//Whether a and b are in the same set
+	bool connected(int32 a, int32 b) { return find(a) == find(b); }
+
+	//Amount of elements
+	int32 num() const { return parents.Num(); }
+
+private:
+	TArray<int32> parents;
+
+	//Upper bound on the height of the tree of each representative
+	TArray<uint8> ranks;
+};
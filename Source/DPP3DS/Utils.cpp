@@ -138,3 +138,5 @@ FMedialAxis::FMedialAxis(TArray<FVector> inVertices, TArray<FPolygonEdge> inEdge
 	vertices = inVertices;
 	edges = inEdges;
 }
+
+FCostPenalties::FCostPenalties() { surfacePenalty = 400; stairsPenalty = 400; }
@@ -286,4 +286,26 @@ public:
 	//Edges of the medial axis
 	UPROPERTY(VisibleAnywhere, Category = "Medial Axis")
 		TArray<FPolygonEdge> edges;
-};
\ No newline at end of file
+};
+
+//Structure for the penalties an agent pays while moving over the roadmap
+USTRUCT()
+struct FCostPenalties
+{
+	GENERATED_BODY()
+
+		FCostPenalties();
+
+public:
+	//Penalty for moving to another surface
+	UPROPERTY(EditAnywhere, Category = "Penalties")
+		float surfacePenalty;
+
+	//Penalty for using the stairs
+	UPROPERTY(EditAnywhere, Category = "Penalties")
+		float stairsPenalty;
+
+	//Extra penalty for moving onto a vertex of a specific surface type
+	UPROPERTY(EditAnywhere, Category = "Penalties")
+		TMap<ESurfaceType, float> surfaceTypePenalties;
+};
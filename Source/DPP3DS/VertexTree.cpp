@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VertexTree.h"
+#include "Vertex.h"
+#include "Algo/Sort.h"
+
+FVertexTreeNode::FVertexTreeNode(AVertex* inVertex, FVector inLocation, int32 inAxis)
+{
+	vertex = inVertex;
+	location = inLocation;
+	axis = inAxis;
+	left = INDEX_NONE;
+	right = INDEX_NONE;
+}
+
+FVertexTree::FVertexTree() {}
+
+void FVertexTree::reset() { nodes.Empty(); }
+
+void FVertexTree::build(const TArray<AVertex*>& inVertices)
+{
+	nodes.Empty(inVertices.Num());
+
+	//Store the location of every vertex once, so it is not requested again while sorting
+	TArray<TPair<AVertex*, FVector>> items;
+	items.Reserve(inVertices.Num());
+	for (AVertex* vertex : inVertices) { if (vertex) { items.Add(TPair<AVertex*, FVector>(vertex, vertex->GetActorLocation())); } }
+
+	buildRange(items, 0, items.Num(), 0);
+}
+
+int32 FVertexTree::buildRange(TArray<TPair<AVertex*, FVector>>& items, int32 begin, int32 end, int32 depth)
+{
+	if (begin >= end) { return INDEX_NONE; }
+
+	//Split at the median along the axis of this depth
+	int32 axis = depth % 3;
+	Sort(items.GetData() + begin, end - begin, [axis](const TPair<AVertex*, FVector>& a, const TPair<AVertex*, FVector>& b) { return a.Value[axis] < b.Value[axis]; });
+	int32 median = (begin + end) / 2;
+
+	int32 nodeIndex = nodes.Add(FVertexTreeNode(items[median].Key, items[median].Value, axis));
+	int32 left = buildRange(items, begin, median, depth + 1);
+	int32 right = buildRange(items, median + 1, end, depth + 1);
+	nodes[nodeIndex].left = left;
+	nodes[nodeIndex].right = right;
+
+	return nodeIndex;
+}
+
+void FVertexTree::insert(AVertex* vertex)
+{
+	if (vertex == nullptr) { return; }
+	FVector location = vertex->GetActorLocation();
+
+	//The first vertex becomes the root
+	if (nodes.Num() < 1) {
+		nodes.Add(FVertexTreeNode(vertex, location, 0));
+		return;
+	}
+
+	//Walk down the tree until an empty child is found
+	int32 current = 0;
+	while (true) {
+		int32 axis = nodes[current].axis;
+		bool goLeft = location[axis] < nodes[current].location[axis];
+		int32 child = goLeft ? nodes[current].left : nodes[current].right;
+
+		if (child == INDEX_NONE) {
+			//Nodes may be reallocated by the add, so set the child index afterwards
+			int32 newIndex = nodes.Add(FVertexTreeNode(vertex, location, (axis + 1) % 3));
+			if (goLeft) { nodes[current].left = newIndex; }
+			else { nodes[current].right = newIndex; }
+			return;
+		}
+		current = child;
+	}
+}
+
+void FVertexTree::findInBox(FVector center, FVector extent, TArray<AVertex*>& outVertices) const
+{
+	TArray<int32> found;
+	findNodesInBox(center, extent, found);
+
+	outVertices.Reserve(outVertices.Num() + found.Num());
+	for (int32 nodeIndex : found) { outVertices.Add(nodes[nodeIndex].vertex); }
+}
+
+void FVertexTree::findLocationsInBox(FVector center, FVector extent, TArray<TPair<AVertex*, FVector>>& outVertices) const
+{
+	TArray<int32> found;
+	findNodesInBox(center, extent, found);
+
+	outVertices.Reserve(outVertices.Num() + found.Num());
+	for (int32 nodeIndex : found) { outVertices.Add(TPair<AVertex*, FVector>(nodes[nodeIndex].vertex, nodes[nodeIndex].location)); }
+}
+
+void FVertexTree::findNearestInBox(FVector center, FVector extent, TArray<AVertex*>& outVertices) const
+{
+	TArray<int32> found;
+	findNodesInBox(center, extent, found);
+
+	//Compute every distance once and sort on it
+	TArray<TPair<float, int32>> distances;
+	distances.Reserve(found.Num());
+	for (int32 nodeIndex : found) { distances.Add(TPair<float, int32>(FVector::DistSquared(nodes[nodeIndex].location, center), nodeIndex)); }
+	Algo::SortBy(distances, [](const TPair<float, int32>& pair) { return pair.Key; });
+
+	outVertices.Reserve(outVertices.Num() + distances.Num());
+	for (const TPair<float, int32>& pair : distances) { outVertices.Add(nodes[pair.Value].vertex); }
+}
+
+bool FVertexTree::hasVertexWithin(FVector center, float distance) const
+{
+	TArray<int32> found;
+	findNodesInBox(center, FVector(distance), found);
+
+	//The box also contains its corners, so check the actual distance
+	float distanceSquared = distance * distance;
+	for (int32 nodeIndex : found) { if (FVector::DistSquared(nodes[nodeIndex].location, center) < distanceSquared) { return true; } }
+	return false;
+}
+
+void FVertexTree::findNodesInBox(FVector center, FVector extent, TArray<int32>& outNodes) const
+{
+	if (nodes.Num() < 1) { return; }
+	FVector boxMin = center - extent;
+	FVector boxMax = center + extent;
+
+	//Visit only the subtrees whose half space overlaps the box. A balanced build can put vertices at the split on either side, so both sides include it
+	TArray<int32, TInlineAllocator<64>> stack;
+	stack.Add(0);
+	while (stack.Num() > 0) {
+		int32 nodeIndex = stack.Pop(false);
+		const FVertexTreeNode& node = nodes[nodeIndex];
+		const FVector& location = node.location;
+
+		if (location.X >= boxMin.X && location.X <= boxMax.X && location.Y >= boxMin.Y && location.Y <= boxMax.Y && location.Z >= boxMin.Z && location.Z <= boxMax.Z) { outNodes.Add(nodeIndex); }
+		if (node.left != INDEX_NONE && boxMin[node.axis] <= location[node.axis]) { stack.Add(node.left); }
+		if (node.right != INDEX_NONE && boxMax[node.axis] >= location[node.axis]) { stack.Add(node.right); }
+	}
+}
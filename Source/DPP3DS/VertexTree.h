@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AVertex;
+
+/**
+ * k-d tree over the locations of the vertices. Used to find nearby vertices during PRM construction without querying the physics scene
+ */
+
+//Node of the k-d tree. Splits the space at the location of its vertex along the given axis
+struct FVertexTreeNode
+{
+	FVertexTreeNode(AVertex* inVertex, FVector inLocation, int32 inAxis);
+
+	//Vertex stored in this node
+	AVertex* vertex;
+
+	//Location of the vertex when it was inserted
+	FVector location;
+
+	//Axis along which this node splits the space (0 = X, 1 = Y, 2 = Z)
+	int32 axis;
+
+	//Indices of the child nodes. INDEX_NONE if there is no child
+	int32 left;
+	int32 right;
+};
+
+class FVertexTree
+{
+public:
+	FVertexTree();
+
+	//Removes all vertices from the tree
+	void reset();
+
+	//Builds a balanced tree from the given vertices, replacing the current contents
+	void build(const TArray<AVertex*>& inVertices);
+
+	//Inserts a single vertex. Used while vertices are generated, so the tree is not rebuilt for every new vertex
+	void insert(AVertex* vertex);
+
+	//Finds all vertices in the box with the given center and half extent
+	void findInBox(FVector center, FVector extent, TArray<AVertex*>& outVertices) const;
+
+	//Finds all vertices in the box with the given center and half extent, together with their locations
+	void findLocationsInBox(FVector center, FVector extent, TArray<TPair<AVertex*, FVector>>& outVertices) const;
+
+	//Finds all vertices in the box with the given center and half extent, sorted so that the vertex nearest to the center is first
+	void findNearestInBox(FVector center, FVector extent, TArray<AVertex*>& outVertices) const;
+
+	//Checks if there is a vertex closer than the given distance to the center
+	bool hasVertexWithin(FVector center, float distance) const;
+
+	//Amount of vertices in the tree
+	int32 num() const { return nodes.Num(); }
+
+private:
+	//Builds the subtree of the items from begin up to end and returns the index of its root
+	int32 buildRange(TArray<TPair<AVertex*, FVector>>& items, int32 begin, int32 end, int32 depth);
+
+	//Finds the indices of all nodes in the box with the given center and half extent
+	void findNodesInBox(FVector center, FVector extent, TArray<int32>& outNodes) const;
+
+	//All nodes of the tree. The root is the first node
+	TArray<FVertexTreeNode> nodes;
+};